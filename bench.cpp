@@ -0,0 +1,323 @@
+// Benchmark suite for the Student Management System.
+//
+// Builds the model from main.cpp without its menu and times each core
+// operation over synthetic datasets of increasing size. Every result is
+// printed as one JSON object per line, so runs can be collected and
+// plotted as scaling curves.
+//
+//   g++ -std=c++17 -O2 -pthread bench.cpp -o sms-bench
+//   ./sms-bench --sizes=1000,10000,100000 --zipf=1.1
+//
+// The default sizes run up to 10^7 students, which needs more than 6 GiB of
+// memory and a few minutes; pass --sizes to stop earlier.
+//
+// Options (all --key=value):
+//   sizes     comma-separated student counts (1000,10000,100000,1000000,10000000)
+//   courses   course count, 0 = students / 50, at least 20       (0)
+//   per       mean enrollments per student                      (4)
+//   dist      enrollments-per-student: fixed, uniform or poisson (poisson)
+//   zipf      course popularity exponent, 0 = uniform          (1.0)
+//   seed      generator seed                                    (42)
+//   budget    time budget per benchmark in milliseconds         (300)
+//   threads   pool size for parallel export/load (hardware threads)
+//   log       on: write the operation log as the CLI does, committing
+//             after every mutating call                         (off)
+#define SMS_NO_MAIN
+#include "main.cpp"
+
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace {
+
+using BenchClock = chrono::steady_clock;
+
+struct BenchOptions {
+    vector<size_t> sizes{1000, 10000, 100000, 1000000, 10000000};
+    size_t courses = 0;
+    double perStudent = 4;
+    string dist = "poisson";
+    double zipf = 1.0;
+    uint64_t seed = 42;
+    int64_t budgetMs = 300;
+    size_t threads = ThreadPool::defaultThreads();
+    bool log = false;
+};
+
+// The dataset shape shared by every result line of one size.
+struct BenchShape {
+    size_t students = 0;
+    size_t courses = 0;
+    size_t enrollments = 0;
+};
+
+const char *const kFirstNames[] = {"Alice", "Bob", "Charlie", "David", "Eve", "Fatima", "George",
+                                   "Hana", "Ivan", "Julia", "Kenji", "Laila", "Mohamed", "Nora",
+                                   "Omar", "Priya", "Quentin", "Rosa", "Samir", "Tara"};
+const char *const kLastNames[] = {"Johnson", "Smith", "Brown", "Williams", "Davis", "Aziz",
+                                  "Garcia", "Chen", "Khan", "Martin", "Nguyen", "Okafor",
+                                  "Park", "Rossi", "Silva", "Tanaka", "Walker", "Young"};
+
+// Zero-padded to `width` digits, e.g. benchCode('S', 42, 8) is S00000042.
+string benchCode(char prefix, size_t i, size_t width) {
+    string digits = to_string(i);
+    return prefix + string(width > digits.size() ? width - digits.size() : 0, '0') + digits;
+}
+
+string benchStudentID(size_t i) { return benchCode('S', i, 8); }
+string benchCourseCode(size_t i) { return benchCode('C', i, 5); }
+
+// Draws course indexes with probability proportional to 1 / (rank + 1)^s,
+// so a few courses are far more popular than the rest. s = 0 is uniform.
+class ZipfSampler {
+private:
+    vector<double> cdf;
+public:
+    ZipfSampler(size_t n, double s) : cdf(n) {
+        double total = 0;
+        for (size_t i = 0; i < n; ++i)
+            cdf[i] = total += pow(double(i + 1), -s);
+        for (double &p : cdf)
+            p /= total;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng &rng) const {
+        double u = uniform_real_distribution<double>(0, 1)(rng);
+        size_t i = size_t(upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+        return min(i, cdf.size() - 1);
+    }
+};
+
+// Fills an empty model with `students` students and the option's course
+// count and enrollment distribution. Enrollments go in through enrollBatch
+// in chunks; pairs that repeat a course for the same student are dropped
+// by the batch, so the result is the number actually enrolled.
+BenchShape generateDataset(StudentManagement &sms, size_t students, const BenchOptions &opt) {
+    BenchShape shape;
+    shape.students = students;
+    shape.courses = opt.courses ? opt.courses : max<size_t>(20, students / 50);
+    mt19937_64 rng(opt.seed);
+
+    const size_t firstCount = size(kFirstNames), lastCount = size(kLastNames);
+    for (size_t i = 0; i < students; ++i) {
+        string name = string(kFirstNames[rng() % firstCount]) + " " + kLastNames[rng() % lastCount];
+        sms.addStudent(name, benchStudentID(i), rng() % 4 ? "Undergraduate" : "Postgraduate");
+    }
+    for (size_t i = 0; i < shape.courses; ++i)
+        sms.addCourse("Course " + to_string(i), benchCourseCode(i));
+
+    ZipfSampler pickCourse(shape.courses, opt.zipf);
+    poisson_distribution<int> poisson(opt.perStudent);
+    uniform_int_distribution<int> uniform(0, max(0, int(2 * opt.perStudent)));
+    auto enrollmentsFor = [&]() -> size_t {
+        if (opt.dist == "fixed")
+            return size_t(opt.perStudent);
+        if (opt.dist == "uniform")
+            return size_t(uniform(rng));
+        return size_t(poisson(rng));
+    };
+
+    vector<string> ids, codes;
+    for (size_t i = 0; i < shape.courses; ++i)
+        codes.push_back(benchCourseCode(i));
+    vector<pair<string_view, string_view>> pairs;
+    const size_t chunk = 1 << 16;
+    for (size_t first = 0; first < students; first += chunk) {
+        size_t last = min(students, first + chunk);
+        ids.clear();
+        for (size_t i = first; i < last; ++i)
+            ids.push_back(benchStudentID(i));
+        pairs.clear();
+        for (const string &id : ids) {
+            size_t count = min(enrollmentsFor(), shape.courses);
+            for (size_t k = 0; k < count; ++k)
+                pairs.emplace_back(id, codes[pickCourse(rng)]);
+        }
+        shape.enrollments += sms.enrollBatch(pairs).enrolled;
+        if (opt.log)
+            sms.commitLog();
+    }
+    return shape;
+}
+
+void printResult(const char *bench, const BenchShape &shape, const BenchOptions &opt, size_t ops, long long ns) {
+    cout << "{\"bench\":\"" << bench << "\",\"students\":" << shape.students
+         << ",\"courses\":" << shape.courses << ",\"enrollments\":" << shape.enrollments
+         << ",\"log\":" << (opt.log ? "true" : "false")
+         << ",\"ops\":" << ops << ",\"total_ns\":" << ns
+         << ",\"ns_per_op\":" << (ops ? ns / (long long)ops : 0) << "}" << endl;
+}
+
+// Runs op(i) for i = 0, 1, ... until maxOps calls or the time budget is
+// spent, checking the clock every few calls so cheap operations are not
+// dominated by it. Prints one result line and returns the calls made.
+template <typename Op>
+size_t measure(const char *bench, const BenchShape &shape, const BenchOptions &opt,
+               size_t maxOps, Op op) {
+    const auto budget = chrono::milliseconds(opt.budgetMs);
+    auto start = BenchClock::now();
+    auto elapsed = BenchClock::duration::zero();
+    size_t ops = 0;
+    while (ops < maxOps) {
+        op(ops++);
+        if ((ops & 15) == 0 || ops < 16) {
+            elapsed = BenchClock::now() - start;
+            if (elapsed >= budget)
+                break;
+        }
+    }
+    elapsed = BenchClock::now() - start;
+    printResult(bench, shape, opt, ops, chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+    return ops;
+}
+
+// The report functions print to cout as well as writing their file; the
+// console output is dropped (a stream without a buffer writes nothing) so
+// only the report work is timed.
+class MuteConsole {
+private:
+    streambuf *saved;
+public:
+    MuteConsole() : saved(cout.rdbuf(nullptr)) {}
+    ~MuteConsole() { cout.rdbuf(saved); }
+};
+
+void runSize(size_t students, const BenchOptions &opt) {
+    StudentManagement sms;
+    sms.messageSink().setMode(MessageMode::None);
+    if (opt.log)
+        sms.openLog();
+    // Mutating benchmarks make each call durable the way one CLI command is.
+    auto commit = [&] {
+        if (opt.log)
+            sms.commitLog();
+    };
+
+    auto start = BenchClock::now();
+    BenchShape shape = generateDataset(sms, students, opt);
+    printResult("generate", shape, opt, 1,
+                chrono::duration_cast<chrono::nanoseconds>(BenchClock::now() - start).count());
+
+    mt19937_64 rng(opt.seed + 1);
+    auto randomStudent = [&]() { return benchStudentID(rng() % students); };
+    auto randomCourse = [&]() { return benchCourseCode(rng() % shape.courses); };
+    const size_t unbounded = numeric_limits<size_t>::max();
+
+    string out;
+    measure("search", shape, opt, unbounded, [&](size_t i) {
+        out.clear();
+        sms.formatSearch(out, kLastNames[i % size(kLastNames)]);
+    });
+    measure("search_ignore_case", shape, opt, unbounded, [&](size_t i) {
+        out.clear();
+        sms.formatSearch(out, kFirstNames[i % size(kFirstNames)], true);
+    });
+    measure("report_course", shape, opt, unbounded, [&](size_t) {
+        MuteConsole mute;
+        sms.generateReportForCourse(randomCourse());
+    });
+    measure("report_student", shape, opt, unbounded, [&](size_t) {
+        MuteConsole mute;
+        sms.generateReportForStudent(randomStudent());
+    });
+    {
+        shared_ptr<const ModelData> version = sms.pinVersion();
+        measure("analytics", shape, opt, unbounded, [&](size_t) { version->computeAnalytics(10, opt.threads); });
+    }
+    // Export and load run before the mutating benchmarks, which change the
+    // model's size, so their numbers describe the generated dataset.
+    measure("export", shape, opt, unbounded, [&](size_t) { sms.exportDataParallel(opt.threads); });
+    measure("load_fast", shape, opt, unbounded, [&](size_t) {
+        StudentManagement fresh;
+        fresh.loadData(LoadMode::Fast);
+    });
+    measure("load_parallel", shape, opt, unbounded, [&](size_t) {
+        StudentManagement fresh;
+        fresh.loadData(LoadMode::Parallel);
+    });
+    measure("enroll", shape, opt, unbounded,
+            [&](size_t) {
+                sms.enrollStudentInCourse(randomStudent(), randomCourse());
+                commit();
+            });
+    measure("add", shape, opt, unbounded, [&](size_t i) {
+        sms.addStudent("Bench Student", benchStudentID(students + i), "Undergraduate");
+        commit();
+    });
+    // Removal only takes out generated students, at most one in ten.
+    vector<size_t> order(students);
+    iota(order.begin(), order.end(), size_t(0));
+    shuffle(order.begin(), order.end(), rng);
+    measure("remove", shape, opt, max<size_t>(1, students / 10),
+            [&](size_t i) {
+                sms.removeStudent(benchStudentID(order[i]));
+                commit();
+            });
+}
+
+bool parseOptions(int argc, char **argv, BenchOptions &opt) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == string::npos) {
+            cerr << "Unrecognized argument: " << arg << "\n";
+            return false;
+        }
+        string key = arg.substr(2, eq - 2), value = arg.substr(eq + 1);
+        try {
+            if (key == "sizes") {
+                opt.sizes.clear();
+                for (string_view rest = value; !rest.empty();)
+                    opt.sizes.push_back(stoull(string(nextField(rest, ','))));
+            } else if (key == "courses") {
+                opt.courses = stoull(value);
+            } else if (key == "per") {
+                opt.perStudent = stod(value);
+            } else if (key == "dist" && (value == "fixed" || value == "uniform" || value == "poisson")) {
+                opt.dist = value;
+            } else if (key == "zipf") {
+                opt.zipf = stod(value);
+            } else if (key == "seed") {
+                opt.seed = stoull(value);
+            } else if (key == "budget") {
+                opt.budgetMs = stoll(value);
+            } else if (key == "threads") {
+                opt.threads = max<size_t>(1, stoull(value));
+            } else if (key == "log" && (value == "on" || value == "off")) {
+                opt.log = value == "on";
+            } else {
+                cerr << "Unrecognized option: " << arg << "\n";
+                return false;
+            }
+        } catch (const exception &) {
+            cerr << "Invalid value: " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    if (!parseOptions(argc, argv, opt))
+        return 2;
+
+    // Export and load work on the usual Students/ and Courses/ paths, so
+    // each run gets its own scratch directory.
+    fs::path home = fs::current_path();
+    fs::path scratch = fs::temp_directory_path() / ("sms-bench-" + to_string(BenchClock::now().time_since_epoch().count()));
+    fs::create_directories(scratch);
+    fs::current_path(scratch);
+    for (size_t students : opt.sizes) {
+        runSize(students, opt);
+        fs::remove_all(scratch / "Reports");
+        fs::remove_all(scratch / "Snapshots");
+    }
+    fs::current_path(home);
+    fs::remove_all(scratch);
+    return 0;
+}
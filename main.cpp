@@ -8,6 +8,7 @@
 //   - Data Export
 // An option to populate dummy data is provided so you can quickly generate test entries.
 // Data is saved in CSV files in separate folders ("Students", "Courses", "Reports").
+// Run with arguments for the non-interactive command line mode (see --help).
 
 #include <iostream>
 #include <vector>
@@ -16,10 +17,59 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <numeric>
 #include <filesystem>
+#include <unordered_map>
 #include <limits>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string_view>
 #include <cctype>     // for isspace, isdigit, tolower
 #include <exception>  // for exception
+#include <functional>
+#include <queue>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+#include <atomic>
+#include <initializer_list>
+#include <iterator>
+#include <memory_resource>
+#include <shared_mutex>
+#include <csignal>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SMS_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define SMS_POSIX 0
+#endif
+
+#if defined(__linux__)
+#define SMS_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#else
+#define SMS_EPOLL 0
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SMS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define SMS_X86_SIMD 0
+#endif
 
 namespace fs = std::filesystem;
 using namespace std;
@@ -88,28 +138,92 @@ string getValidStudentType() {
     return type;
 }
 
-// Check if a student ID is valid (format Sxxx, e.g., S001) (UPDATED)
-bool isValidStudentID(const string &studentID) {
-    if (studentID.size() != 4)
+// ----------------------------
+// Student ID Format
+// ----------------------------
+// Student IDs are 'S' followed by a configurable number of digits, 3 to 9
+// by default (S001 ... S999999999); --id-digits changes the range. The
+// range only governs what the menu accepts: the loaders take whatever the
+// files hold.
+struct StudentIdFormat {
+    static constexpr unsigned kMaxDigits = 9; // the most a packed ID can hold
+    unsigned minDigits = 3;
+    unsigned maxDigits = kMaxDigits;
+};
+
+StudentIdFormat &studentIdFormat() {
+    static StudentIdFormat format;
+    return format;
+}
+
+// Parse "<max>" or "<min>-<max>" for --id-digits.
+bool parseIdDigits(string_view text, StudentIdFormat &format) {
+    auto digits = [](string_view s, unsigned &value) {
+        if (s.size() != 1 || s[0] < '1' || s[0] > '9')
+            return false;
+        value = unsigned(s[0] - '0');
+        return true;
+    };
+    size_t dash = text.find('-');
+    StudentIdFormat parsed;
+    parsed.minDigits = 1;
+    if (dash == string_view::npos ? !digits(text, parsed.maxDigits)
+                                  : !digits(text.substr(0, dash), parsed.minDigits) ||
+                                        !digits(text.substr(dash + 1), parsed.maxDigits))
+        return false;
+    if (parsed.minDigits > parsed.maxDigits)
         return false;
-    if (studentID[0] != 'S')
+    format = parsed;
+    return true;
+}
+
+// Pack 'S' plus 1 to 9 digits into one integer: the digits left-aligned
+// to nine places, times 16, plus the digit count. Packed IDs compare in the
+// same order as their text (S01 < S1 < S10), and equal text gives equal
+// keys, so they can be hashed, compared and sorted as plain integers.
+// Returns false for anything else (such IDs fall back to text).
+inline bool packStudentID(string_view id, uint64_t &key) {
+    static constexpr uint64_t kScale[] = {1, 100000000, 10000000, 1000000, 100000,
+                                          10000, 1000, 100, 10, 1};
+    size_t digits = id.size() - 1;
+    if (id.size() < 2 || digits > StudentIdFormat::kMaxDigits || id[0] != 'S')
         return false;
-    for (size_t i = 1; i < studentID.size(); ++i) {
-        if (!isdigit(studentID[i]))
+    uint64_t value = 0;
+    for (size_t i = 1; i < id.size(); ++i) {
+        unsigned d = unsigned(id[i]) - '0';
+        if (d > 9)
             return false;
+        value = value * 10 + d;
     }
+    key = (value * kScale[digits]) << 4 | digits;
     return true;
 }
 
-// Get a valid student ID (ensuring the format Sxxx) (UPDATED)
+// Check if a student ID is valid: 'S' and the configured number of digits.
+// (UPDATED: was exactly Sxxx)
+bool isValidStudentID(const string &studentID) {
+    const StudentIdFormat &format = studentIdFormat();
+    size_t digits = studentID.size() - 1;
+    uint64_t key;
+    return !studentID.empty() && digits >= format.minDigits && digits <= format.maxDigits &&
+           packStudentID(studentID, key);
+}
+
+// Get a valid student ID in the configured format (UPDATED)
 string getValidStudentID() {
+    const StudentIdFormat &format = studentIdFormat();
+    string example = "S" + string(format.minDigits - 1, '0') + "1";
+    string range = format.minDigits == format.maxDigits
+                       ? to_string(format.minDigits)
+                       : to_string(format.minDigits) + " to " + to_string(format.maxDigits);
     string id;
     while (true) {
-        id = getNonEmptyInput("Enter student ID (format Sxxx, e.g., S001): ");
+        id = getNonEmptyInput("Enter student ID (S followed by " + range + " digits, e.g., " + example + "): ");
         if (isValidStudentID(id))
             break;
         else
-            cout << "Invalid student ID format. Please follow the format Sxxx (e.g., S001).\n";
+            cout << "Invalid student ID format. Please use S followed by " << range
+                 << " digits (e.g., " << example << ").\n";
     }
     return id;
 }
@@ -132,470 +246,5840 @@ int getValidChoice() {
 }
 
 // ----------------------------
-// Abstract Base Class: Student
+// Utility Functions for CSV Parsing
 // ----------------------------
-class Student {
-protected:
-    string name;
-    string studentID;
-    vector<string> enrolledCourses;  // stores course codes
-public:
-    Student(const string &name, const string &studentID)
-        : name(name), studentID(studentID) {}
-    virtual ~Student() {}
 
-    string getName() const { return name; }
-    string getID() const { return studentID; }
-    const vector<string>& getCourses() const { return enrolledCourses; }
-
-    // Enroll in a course
-    void addCourse(const string &courseCode) {
-        if (find(enrolledCourses.begin(), enrolledCourses.end(), courseCode) == enrolledCourses.end())
-            enrolledCourses.push_back(courseCode);
+// Split the next line (without its '\n') off the front of text.
+// Returns false once text is exhausted, like getline at end of file.
+bool nextLine(string_view &text, string_view &line) {
+    if (text.empty())
+        return false;
+    size_t end = text.find('\n');
+    if (end == string_view::npos) {
+        line = text;
+        text = string_view();
+    } else {
+        line = text.substr(0, end);
+        text.remove_prefix(end + 1);
     }
+    return true;
+}
 
-    // Remove a course enrollment
-    void removeCourse(const string &courseCode) {
-        enrolledCourses.erase(remove(enrolledCourses.begin(), enrolledCourses.end(), courseCode), enrolledCourses.end());
-    }
+// Split the next sep-terminated field off the front of text. A missing
+// field comes back empty, matching getline(stream, field, sep).
+string_view nextField(string_view &text, char sep) {
+    size_t end = text.find(sep);
+    string_view field = text.substr(0, end);
+    text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+    return field;
+}
+
+// One CSV row split into fields. The trailing ';'-separated list (enrolled
+// courses or enrolled students) is split into CsvBatch::refs.
+struct CsvRow {
+    string_view key;   // student ID or course code
+    string_view name;
+    string_view type;  // empty for courses.csv
+    size_t firstRef = 0;
+    size_t refCount = 0;
+};
 
-    // Pure virtual function to get student type (e.g., Undergraduate, Postgraduate)
-    virtual string getType() const = 0;
+// Parsed rows staged for merging; all views point into the source buffer.
+struct CsvBatch {
+    vector<CsvRow> rows;
+    vector<string_view> refs;
+
+    void clear() {
+        rows.clear();
+        refs.clear();
+    }
 };
 
+// Parse one non-empty line of students.csv (hasType) or courses.csv.
+void parseCsvRow(string_view line, bool hasType, CsvBatch &batch) {
+    CsvRow row;
+    row.key = nextField(line, ',');
+    row.name = nextField(line, ',');
+    if (hasType)
+        row.type = nextField(line, ',');
+    row.firstRef = batch.refs.size();
+    while (!line.empty())
+        batch.refs.push_back(nextField(line, ';'));
+    row.refCount = batch.refs.size() - row.firstRef;
+    batch.rows.push_back(row);
+}
+
+// Parse every non-empty line of text into batch.
+void parseCsvRows(string_view text, bool hasType, CsvBatch &batch) {
+    string_view line;
+    while (nextLine(text, line))
+        if (!line.empty())
+            parseCsvRow(line, hasType, batch);
+}
+
+// Cut text into about `parts` pieces, each ending just after a '\n' (the
+// last one runs to the end), so no line is split between two pieces.
+vector<string_view> splitAtLines(string_view text, size_t parts) {
+    vector<string_view> pieces;
+    size_t target = max<size_t>(1, text.size() / max<size_t>(1, parts));
+    while (!text.empty()) {
+        size_t end = target >= text.size() ? string_view::npos : text.find('\n', target);
+        size_t len = end == string_view::npos ? text.size() : end + 1;
+        pieces.push_back(text.substr(0, len));
+        text.remove_prefix(len);
+    }
+    return pieces;
+}
+
 // ----------------------------
-// Derived Class: Undergraduate
+// Class: ThreadPool
 // ----------------------------
-class Undergraduate : public Student {
+// Fixed set of worker threads draining a FIFO task queue. wait() blocks
+// until every submitted task has finished and rethrows the first exception
+// a task raised, if any.
+class ThreadPool {
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex lock;
+    condition_variable taskReady;
+    condition_variable allDone;
+    size_t pending = 0;
+    bool stopping = false;
+    exception_ptr failure;
+
+    void run() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> guard(lock);
+                taskReady.wait(guard, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = move(tasks.front());
+                tasks.pop();
+            }
+            try {
+                task();
+            } catch (...) {
+                lock_guard<mutex> guard(lock);
+                if (!failure)
+                    failure = current_exception();
+            }
+            lock_guard<mutex> guard(lock);
+            if (--pending == 0)
+                allDone.notify_all();
+        }
+    }
+
 public:
-    Undergraduate(const string &name, const string &studentID)
-        : Student(name, studentID) {}
-    virtual string getType() const override {
-        return "Undergraduate";
+    static size_t defaultThreads() {
+        unsigned n = thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    explicit ThreadPool(size_t threads = defaultThreads()) {
+        for (size_t i = 0; i < max<size_t>(1, threads); ++i)
+            workers.emplace_back([this] { run(); });
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    void submit(function<void()> task) {
+        {
+            lock_guard<mutex> guard(lock);
+            tasks.push(move(task));
+            pending++;
+        }
+        taskReady.notify_one();
+    }
+
+    void wait() {
+        unique_lock<mutex> guard(lock);
+        allDone.wait(guard, [this] { return pending == 0; });
+        if (failure) {
+            exception_ptr error = failure;
+            failure = nullptr;
+            rethrow_exception(error);
+        }
     }
 };
 
 // ----------------------------
-// Derived Class: Postgraduate
+// Class: MappedFile
 // ----------------------------
-class Postgraduate : public Student {
+// Read-only view of a whole file. Uses mmap where available so parsing
+// works directly on the page cache; elsewhere the file is read into memory
+// in a single block. Pass sequential = false for a file read in place at
+// random, so the kernel does not read ahead of each touched page.
+class MappedFile {
+private:
+    const char *data = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#if SMS_POSIX
+    void *mapping = nullptr;
+#else
+    vector<char> buffer;
+#endif
+
 public:
-    Postgraduate(const string &name, const string &studentID)
-        : Student(name, studentID) {}
-    virtual string getType() const override {
-        return "Postgraduate";
+    explicit MappedFile(const string &filename, bool sequential = true) {
+#if SMS_POSIX
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            length = static_cast<size_t>(st.st_size);
+            if (length == 0) {
+                opened = true;
+            } else {
+                void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    madvise(p, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+                    mapping = p;
+                    data = static_cast<const char *>(p);
+                    opened = true;
+                }
+            }
+        }
+        ::close(fd);
+#else
+        ifstream file(filename, ios::binary | ios::ate);
+        if (!file)
+            return;
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        if (!buffer.empty() && !file.read(buffer.data(), buffer.size()))
+            return;
+        data = buffer.data();
+        length = buffer.size();
+        opened = true;
+#endif
+    }
+
+    ~MappedFile() {
+#if SMS_POSIX
+        if (mapping)
+            munmap(mapping, length);
+#endif
     }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return opened; }
+    string_view view() const { return string_view(data, length); }
 };
 
+uint64_t checksum64(string_view bytes); // see Binary Snapshot Helpers
+
 // ----------------------------
-// Class: Course
+// Class: SnapshotPages
 // ----------------------------
-class Course {
+// A snapshot file mapped for reading in place, with a checksum for every
+// kChunk bytes of its payload. A chunk is verified the first time a read
+// touches it, so a lazy load only ever reads the pages it uses. A chunk
+// that fails reads as missing; the first one found is reported, and
+// damaged() keeps a snapshot from being written from the damaged data.
+class SnapshotPages {
 private:
-    string courseName;
-    string courseCode;
-    vector<string> enrolledStudentIDs; // storing student IDs
+    string path;
+    MappedFile file;
+    string_view payload;
+    const char *sums = nullptr;           // one uint64 per chunk
+    unique_ptr<atomic<uint8_t>[]> state;  // per chunk: 0 unchecked, 1 intact, 2 damaged
+    mutable atomic<bool> anyDamaged{false};
+
 public:
-    Course(const string &courseName, const string &courseCode)
-        : courseName(courseName), courseCode(courseCode) {}
+    static constexpr size_t kChunk = 64 << 10;
+
+    SnapshotPages(const string &filename, bool sequential) : path(filename), file(filename, sequential) {}
 
-    string getCourseName() const { return courseName; }
-    string getCourseCode() const { return courseCode; }
-    const vector<string>& getEnrolledStudents() const { return enrolledStudentIDs; }
+    const MappedFile &mapping() const { return file; }
 
-    // Add a student to the course
-    void addStudent(const string &studentID) {
-        if (find(enrolledStudentIDs.begin(), enrolledStudentIDs.end(), studentID) == enrolledStudentIDs.end())
-            enrolledStudentIDs.push_back(studentID);
+    // Cover `bytes` with the chunk checksums in `table`. An empty table
+    // means the caller has already verified all of it.
+    void setChunks(string_view bytes, string_view table) {
+        payload = bytes;
+        sums = table.data();
+        size_t chunks = (bytes.size() + kChunk - 1) / kChunk;
+        state.reset(new atomic<uint8_t>[chunks]);
+        for (size_t i = 0; i < chunks; ++i)
+            state[i].store(table.empty() ? 1 : 0, memory_order_relaxed);
     }
 
-    // Remove a student from the course
-    void removeStudent(const string &studentID) {
-        enrolledStudentIDs.erase(remove(enrolledStudentIDs.begin(), enrolledStudentIDs.end(), studentID), enrolledStudentIDs.end());
+    // True if every chunk under [p, p + length) is intact; p points into
+    // the payload. The first damaged chunk found is reported on cerr
+    // unless `report` is false. Safe to call from several threads at once.
+    bool verify(const char *p, size_t length, bool report = true) const {
+        if (length == 0)
+            return true;
+        size_t offset = static_cast<size_t>(p - payload.data());
+        bool intact = true;
+        for (size_t i = offset / kChunk; i <= (offset + length - 1) / kChunk; ++i) {
+            uint8_t s = state[i].load(memory_order_acquire);
+            if (s == 0) {
+                uint64_t expected;
+                memcpy(&expected, sums + 8 * i, 8);
+                s = checksum64(payload.substr(i * kChunk, kChunk)) == expected ? 1 : 2;
+                state[i].store(s, memory_order_release);
+                if (s == 2 && !anyDamaged.exchange(true) && report)
+                    cerr << "Warning: snapshot " << path << " is damaged near byte " << i * kChunk
+                         << " of its payload; the names and enrollments stored there read as missing.\n";
+            }
+            intact = intact && s == 1;
+        }
+        return intact;
     }
+
+    bool damaged() const { return anyDamaged.load(); }
 };
 
+#if SMS_POSIX
+// write() until everything is out, retrying short writes and EINTR.
+bool writeFully(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+#endif
+
 // ----------------------------
-// Class: StudentManagement
+// LZ4 Frame Compression
 // ----------------------------
-class StudentManagement {
+// Self-contained LZ4 (frame format 1.6) writer and reader, so exports can
+// be compressed without an external library; the files open with the
+// standard lz4 tool. Frames use independent blocks of at most 4 MiB and
+// end with an xxHash32 checksum of their content, so whole frames can be
+// compressed on separate threads and concatenated: a file may hold any
+// number of frames back to back. The compressor is a single-probe greedy
+// matcher, about lz4's default speed.
+const uint32_t kLz4Magic = 0x184D2204;
+const size_t kLz4BlockSize = 4 << 20;
+
+// Streaming xxHash32, for checksums over data that arrives in pieces.
+class Xxh32 {
 private:
-    vector<unique_ptr<Student>> students;
-    vector<Course> courses;
+    static constexpr uint32_t P1 = 2654435761U, P2 = 2246822519U, P3 = 3266489917U, P4 = 668265263U,
+                              P5 = 374761393U;
+    uint32_t seed;
+    uint32_t v[4];
+    uint64_t total = 0;
+    char tail[16];
+    size_t tailSize = 0;
 
-    // Utility: Find student index by studentID
-    int findStudentIndex(const string &studentID) {
-        for (size_t i = 0; i < students.size(); ++i) {
-            if (students[i]->getID() == studentID)
-                return static_cast<int>(i);
-        }
-        return -1;
+    static uint32_t rotl(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+    static uint32_t read32(const char *p) {
+        uint32_t value;
+        memcpy(&value, p, 4);
+        return value;
+    }
+    void round(const char *p) {
+        for (int i = 0; i < 4; ++i)
+            v[i] = rotl(v[i] + read32(p + 4 * i) * P2, 13) * P1;
     }
 
-    // Utility: Find course index by courseCode
-    int findCourseIndex(const string &courseCode) {
-        for (size_t i = 0; i < courses.size(); ++i) {
-            if (courses[i].getCourseCode() == courseCode)
-                return static_cast<int>(i);
+public:
+    explicit Xxh32(uint32_t seed = 0) : seed(seed), v{seed + P1 + P2, seed + P2, seed, seed - P1} {}
+
+    void update(const char *data, size_t size) {
+        total += size;
+        if (tailSize) {
+            size_t fill = min(size, sizeof(tail) - tailSize);
+            memcpy(tail + tailSize, data, fill);
+            tailSize += fill;
+            data += fill;
+            size -= fill;
+            if (tailSize < sizeof(tail))
+                return;
+            round(tail);
+            tailSize = 0;
         }
-        return -1;
+        for (; size >= 16; data += 16, size -= 16)
+            round(data);
+        memcpy(tail, data, size);
+        tailSize = size;
     }
 
-    // Ensure directory exists
-    void ensureDirectory(const string &dirName) {
-        if (!fs::exists(dirName))
-            fs::create_directories(dirName);
+    uint32_t digest() const {
+        uint32_t h = total >= 16 ? rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18) : seed + P5;
+        h += static_cast<uint32_t>(total);
+        const char *p = tail, *end = tail + tailSize;
+        for (; end - p >= 4; p += 4)
+            h = rotl(h + read32(p) * P3, 17) * P4;
+        for (; p < end; ++p)
+            h = rotl(h + static_cast<uint8_t>(*p) * P5, 11) * P1;
+        h ^= h >> 15;
+        h *= P2;
+        h ^= h >> 13;
+        h *= P3;
+        h ^= h >> 16;
+        return h;
     }
+};
 
-public:
-    // ----------------------------
-    // Student Management Functions
-    // ----------------------------
-    void addStudent(const string &name, const string &studentID, const string &type) {
-        // Prevent duplicate student IDs.
-        if (findStudentIndex(studentID) != -1) {
-            cout << "Student with ID " << studentID << " already exists.\n";
-            return;
+uint32_t xxh32(const char *data, size_t size, uint32_t seed = 0) {
+    Xxh32 hash(seed);
+    hash.update(data, size);
+    return hash.digest();
+}
+
+void appendLE32(string &out, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+uint32_t readLE32(const char *p) {
+    return uint32_t(uint8_t(p[0])) | uint32_t(uint8_t(p[1])) << 8 | uint32_t(uint8_t(p[2])) << 16 |
+           uint32_t(uint8_t(p[3])) << 24;
+}
+
+// Append src as one LZ4 block (without its size prefix).
+void lz4CompressBlock(const char *src, size_t size, string &out) {
+    const size_t kLastLiterals = 5, kMatchFindLimit = 12, kMaxOffset = 65535;
+    const int kHashBits = 16;
+    thread_local vector<uint32_t> table;
+    table.assign(size_t(1) << kHashBits, 0);
+    auto read32 = [src](size_t pos) { uint32_t v; memcpy(&v, src + pos, 4); return v; };
+    auto putLength = [&out](size_t rest) {
+        for (; rest >= 255; rest -= 255)
+            out.push_back(char(255));
+        out.push_back(static_cast<char>(rest));
+    };
+    auto emit = [&](size_t literalStart, size_t literals, size_t offset, size_t match) {
+        size_t token = out.size();
+        out.push_back(0);
+        uint8_t bits = uint8_t(min<size_t>(literals, 15) << 4);
+        if (literals >= 15)
+            putLength(literals - 15);
+        out.append(src + literalStart, literals);
+        if (match) {
+            out.push_back(static_cast<char>(offset & 0xFF));
+            out.push_back(static_cast<char>(offset >> 8));
+            bits |= uint8_t(min<size_t>(match - 4, 15));
+            if (match - 4 >= 15)
+                putLength(match - 4 - 15);
         }
-        if (type == "Undergraduate")
-            students.push_back(make_unique<Undergraduate>(name, studentID));
-        else if (type == "Postgraduate")
-            students.push_back(make_unique<Postgraduate>(name, studentID));
-        else {
-            cout << "Unknown student type. Please use 'Undergraduate' or 'Postgraduate'.\n";
-            return;
+        out[token] = static_cast<char>(bits);
+    };
+
+    size_t anchor = 0, pos = 0;
+    if (size > kMatchFindLimit) {
+        const size_t searchEnd = size - kMatchFindLimit, matchEnd = size - kLastLiterals;
+        while (pos < searchEnd) {
+            uint32_t sequence = read32(pos);
+            uint32_t &slot = table[(sequence * 2654435761U) >> (32 - kHashBits)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(pos);
+            if (candidate >= pos || pos - candidate > kMaxOffset || read32(candidate) != sequence) {
+                pos += 1 + ((pos - anchor) >> 6); // step faster through incompressible runs
+                continue;
+            }
+            while (pos > anchor && candidate > 0 && src[pos - 1] == src[candidate - 1]) {
+                --pos;
+                --candidate;
+            }
+            // Extend the match 8 bytes at a time; the first differing byte
+            // is the lowest set byte of the xor.
+            size_t end = pos + 4;
+            while (end + 8 <= matchEnd) {
+                uint64_t a, b;
+                memcpy(&a, src + end, 8);
+                memcpy(&b, src + candidate + end - pos, 8);
+                if (a != b) {
+                    end += size_t(__builtin_ctzll(a ^ b)) >> 3;
+                    break;
+                }
+                end += 8;
+            }
+            if (end + 8 > matchEnd) {
+                while (end < matchEnd && src[end] == src[candidate + end - pos])
+                    ++end;
+            }
+            emit(anchor, pos - anchor, pos - candidate, end - pos);
+            pos = anchor = end;
         }
-        cout << "Student added: " << name << " (" << type << ")\n";
     }
+    emit(anchor, size - anchor, 0, 0);
+}
 
-    void removeStudent(const string &studentID) {
-        int idx = findStudentIndex(studentID);
-        if (idx == -1) {
-            cout << "Student with ID " << studentID << " not found.\n";
-            return;
+// Decode one block into out[prefix, capacity); matches may reach back
+// into out[0, prefix), the history of a frame with linked blocks. False
+// if the block is malformed or would not fit; `written` is the decoded size.
+bool lz4DecompressBlock(string_view in, char *out, size_t capacity, size_t &written, size_t prefix = 0) {
+    size_t ip = 0, op = prefix;
+    auto getLength = [&](size_t &length) {
+        uint8_t byte;
+        do {
+            if (ip >= in.size())
+                return false;
+            byte = static_cast<uint8_t>(in[ip++]);
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+    while (ip < in.size()) {
+        uint8_t token = static_cast<uint8_t>(in[ip++]);
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLength(literals))
+            return false;
+        if (literals > in.size() - ip || literals > capacity - op)
+            return false;
+        memcpy(out + op, in.data() + ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == in.size())
+            break; // the last sequence has no match
+        if (in.size() - ip < 2)
+            return false;
+        size_t offset = uint8_t(in[ip]) | size_t(uint8_t(in[ip + 1])) << 8;
+        ip += 2;
+        size_t match = token & 15;
+        if (match == 15 && !getLength(match))
+            return false;
+        match += 4;
+        if (offset == 0 || offset > op || match > capacity - op)
+            return false;
+        if (offset >= match) {
+            memcpy(out + op, out + op - offset, match);
+        } else {
+            for (size_t i = 0; i < match; ++i)
+                out[op + i] = out[op - offset + i];
         }
-        // Remove student from any enrolled courses
-        for (auto &course : courses)
-            course.removeStudent(studentID);
-        students.erase(students.begin() + idx);
-        cout << "Student removed: " << studentID << "\n";
+        op += match;
     }
+    written = op - prefix;
+    return true;
+}
 
-    void listStudents() const {
-        cout << "\n--- List of Students ---\n";
-        for (const auto &student : students) {
-            cout << "Name: " << student->getName()
-                 << ", ID: " << student->getID()
-                 << ", Type: " << student->getType() << "\n";
+// Frame header: independent 4 MiB blocks and a content checksum, the
+// lz4 tool's defaults.
+void lz4AppendFrameHeader(string &out) {
+    const char descriptor[2] = {0x64, 0x70};
+    appendLE32(out, kLz4Magic);
+    out.append(descriptor, 2);
+    out.push_back(static_cast<char>((xxh32(descriptor, 2) >> 8) & 0xFF));
+}
+
+// Append src as blocks of at most kLz4BlockSize; a block that does not
+// shrink is stored as is.
+void lz4AppendBlocks(string &out, string_view src) {
+    string packed;
+    for (size_t start = 0; start < src.size(); start += kLz4BlockSize) {
+        size_t size = min(kLz4BlockSize, src.size() - start);
+        packed.clear();
+        lz4CompressBlock(src.data() + start, size, packed);
+        bool stored = packed.size() >= size;
+        string_view block = stored ? src.substr(start, size) : string_view(packed);
+        appendLE32(out, static_cast<uint32_t>(block.size()) | (stored ? 0x80000000U : 0));
+        out.append(block);
+    }
+}
+
+// End a frame whose uncompressed content hashes to `checksum`.
+void lz4AppendEndMark(string &out, uint32_t checksum) {
+    appendLE32(out, 0);
+    appendLE32(out, checksum);
+}
+
+// Append src as one complete frame.
+void lz4AppendFrame(string &out, string_view src) {
+    lz4AppendFrameHeader(out);
+    lz4AppendBlocks(out, src);
+    lz4AppendEndMark(out, xxh32(src.data(), src.size()));
+}
+
+bool isLz4(string_view data) {
+    return data.size() >= 4 && readLE32(data.data()) == kLz4Magic;
+}
+
+// Decodes the frames of an LZ4 file one block at a time, so memory stays
+// at one block however large the file is. Block and content checksums
+// are verified when present; skippable frames are skipped.
+class Lz4FrameReader {
+private:
+    string_view data;
+    size_t pos = 0;
+    size_t blockMax = 0;     // 0 between frames
+    bool blockChecksums = false;
+    bool contentChecksum = false;
+    bool linked = false;
+    string history; // the last 64 KiB decoded, for linked blocks
+    Xxh32 content;
+    bool ok = true;
+
+    bool startFrame() {
+        while (data.size() - pos >= 8 && (readLE32(data.data() + pos) & 0xFFFFFFF0U) == 0x184D2A50U) {
+            uint32_t skip = readLE32(data.data() + pos + 4);
+            if (skip > data.size() - pos - 8)
+                return ok = false;
+            pos += 8 + skip;
         }
+        if (pos == data.size())
+            return false;
+        if (data.size() - pos < 7 || readLE32(data.data() + pos) != kLz4Magic)
+            return ok = false;
+        uint8_t flags = static_cast<uint8_t>(data[pos + 4]), bd = static_cast<uint8_t>(data[pos + 5]);
+        size_t header = 2 + ((flags & 0x08) ? 8 : 0) + ((flags & 0x01) ? 4 : 0);
+        if ((flags >> 6) != 1 || data.size() - pos - 4 < header + 1)
+            return ok = false;
+        if (static_cast<uint8_t>(xxh32(data.data() + pos + 4, header) >> 8) != static_cast<uint8_t>(data[pos + 4 + header]))
+            return ok = false;
+        int sizeCode = (bd >> 4) & 7;
+        if (sizeCode < 4)
+            return ok = false;
+        blockMax = size_t(1) << (8 + 2 * sizeCode);
+        blockChecksums = flags & 0x10;
+        contentChecksum = flags & 0x04;
+        linked = !(flags & 0x20);
+        history.clear();
+        content = Xxh32();
+        pos += 4 + header + 1;
+        return true;
     }
 
-    void searchStudent(const string &keyword) const {
-        cout << "\n--- Search Results for \"" << keyword << "\" ---\n";
-        bool found = false;
-        for (const auto &student : students) {
-            if (student->getName().find(keyword) != string::npos ||
-                student->getID().find(keyword) != string::npos) {
-                cout << "Name: " << student->getName()
-                     << ", ID: " << student->getID()
-                     << ", Type: " << student->getType() << "\n";
-                found = true;
-            }
-            else {
-                // Also search in enrolled courses
-                const auto &courseList = student->getCourses();
-                for (const auto &course : courseList) {
-                    if (course.find(keyword) != string::npos) {
-                        cout << "Name: " << student->getName()
-                             << ", ID: " << student->getID()
-                             << ", Type: " << student->getType() << "\n";
-                        found = true;
-                        break;
-                    }
+public:
+    explicit Lz4FrameReader(string_view data) : data(data) {}
+
+    bool failed() const { return !ok; }
+
+    // Replace block with the next decoded block; false at the end of the
+    // data or on damage (then failed() is true).
+    bool next(string &block) {
+        while (ok) {
+            if (blockMax == 0 && !startFrame())
+                return false;
+            if (data.size() - pos < 4)
+                return ok = false;
+            uint32_t word = readLE32(data.data() + pos);
+            pos += 4;
+            if (word == 0) {
+                if (contentChecksum) {
+                    if (data.size() - pos < 4 || readLE32(data.data() + pos) != content.digest())
+                        return ok = false;
+                    pos += 4;
                 }
+                blockMax = 0;
+                continue;
+            }
+            size_t size = word & 0x7FFFFFFFU;
+            bool stored = word & 0x80000000U;
+            size_t tail = blockChecksums ? 4 : 0;
+            if (size > blockMax || size + tail > data.size() - pos)
+                return ok = false;
+            string_view body = data.substr(pos, size);
+            pos += size;
+            if (blockChecksums) {
+                if (xxh32(body.data(), body.size()) != readLE32(data.data() + pos))
+                    return ok = false;
+                pos += 4;
+            }
+            if (stored) {
+                block.assign(body.data(), body.size());
+            } else if (!linked) {
+                size_t written = 0;
+                block.resize(blockMax);
+                if (!lz4DecompressBlock(body, &block[0], blockMax, written))
+                    return ok = false;
+                block.resize(written);
+            } else {
+                size_t written = 0, prefix = history.size();
+                history.resize(prefix + blockMax);
+                if (!lz4DecompressBlock(body, &history[0], history.size(), written, prefix))
+                    return ok = false;
+                block.assign(history, prefix, written);
+                history.resize(prefix);
             }
+            if (linked) {
+                const size_t kWindow = 64 << 10;
+                history.append(block);
+                if (history.size() > kWindow)
+                    history.erase(0, history.size() - kWindow);
+            }
+            if (contentChecksum)
+                content.update(block.data(), block.size());
+            return true;
         }
-        if (!found)
-            cout << "No matching student found.\n";
+        return false;
     }
+};
 
-    // ----------------------------
-    // Course Management Functions
-    // ----------------------------
-    void addCourse(const string &courseName, const string &courseCode) {
-        if (findCourseIndex(courseCode) != -1) {
-            cout << "Course with code " << courseCode << " already exists.\n";
-            return;
-        }
-        courses.emplace_back(courseName, courseCode);
-        cout << "Course added: " << courseName << " (" << courseCode << ")\n";
-    }
+// ----------------------------
+// Export Compression
+// ----------------------------
+// With --compress, CSV exports, change files and reports are written as
+// LZ4 under their usual name plus ".lz4", replacing the plain file. The
+// loaders accept either form and read whichever was written last.
+bool &compressExports() {
+    static bool enabled = false;
+    return enabled;
+}
 
-    void removeCourse(const string &courseCode) {
-        int idx = findCourseIndex(courseCode);
-        if (idx == -1) {
-            cout << "Course with code " << courseCode << " not found.\n";
-            return;
+// The name an export to `path` is written under.
+string exportName(const string &path) {
+    return compressExports() ? path + ".lz4" : path;
+}
+
+// After writing an export, drop the other form of the same file.
+void removeOtherForm(const string &path) {
+    error_code ec;
+    fs::remove(compressExports() ? path : path + ".lz4", ec);
+}
+
+// The newer of `path` and `path.lz4` that exists, or `path` if neither does.
+string dataFileName(const string &path) {
+    error_code ec, ecLz4;
+    string packed = path + ".lz4";
+    auto plainTime = fs::last_write_time(path, ec);
+    auto packedTime = fs::last_write_time(packed, ecLz4);
+    if (ecLz4)
+        return path;
+    return ec || packedTime > plainTime ? packed : path;
+}
+
+// Write `parts` back to back to a file, LZ4-compressed (as one frame) if
+// exports are. Returns false on a write error.
+bool writeExportFile(const string &path, initializer_list<string_view> parts) {
+    ofstream file(exportName(path), ios::binary);
+    if (compressExports()) {
+        string packed;
+        Xxh32 content;
+        lz4AppendFrameHeader(packed);
+        for (string_view part : parts) {
+            content.update(part.data(), part.size());
+            lz4AppendBlocks(packed, part);
         }
-        // Remove course from students' enrolled lists
-        for (auto &student : students)
-            student->removeCourse(courseCode);
-        courses.erase(courses.begin() + idx);
-        cout << "Course removed: " << courseCode << "\n";
+        lz4AppendEndMark(packed, content.digest());
+        file.write(packed.data(), static_cast<streamsize>(packed.size()));
+    } else {
+        for (string_view part : parts)
+            file.write(part.data(), static_cast<streamsize>(part.size()));
     }
+    file.close();
+    if (!file)
+        return false;
+    removeOtherForm(path);
+    return true;
+}
 
-    void listCourses() const {
-        cout << "\n--- List of Courses ---\n";
-        for (const auto &course : courses) {
-            cout << "Course Name: " << course.getCourseName()
-                 << ", Course Code: " << course.getCourseCode() << "\n";
+// The body of a CSV file (after its header line) in pieces of whole
+// lines, plain or LZ4. A compressed file is decoded one block at a time,
+// with a line cut by a block boundary carried into the next piece.
+class CsvBodyReader {
+private:
+    MappedFile file;
+    Lz4FrameReader frames{string_view()};
+    bool compressed = false;
+    bool started = false;
+    bool done = false;
+    string block, piece, pending;
+
+public:
+    explicit CsvBodyReader(const string &filename) : file(filename) {
+        if (file.isOpen() && isLz4(file.view())) {
+            compressed = true;
+            frames = Lz4FrameReader(file.view());
         }
     }
 
-    // ----------------------------
-    // Enrollment Functions
-    // ----------------------------
-    void enrollStudentInCourse(const string &studentID, const string &courseCode) {
-        int sIdx = findStudentIndex(studentID);
-        int cIdx = findCourseIndex(courseCode);
-        if (sIdx == -1) {
-            cout << "Student with ID " << studentID << " not found.\n";
-            return;
+    bool isOpen() const { return file.isOpen(); }
+    bool failed() const { return frames.failed(); }
+
+    // The next run of whole lines (the file's last line may lack its
+    // newline); the view is valid until the next call.
+    bool next(string_view &text) {
+        string_view header;
+        if (!compressed) {
+            if (started)
+                return false;
+            started = true;
+            text = file.view();
+            nextLine(text, header);
+            return true;
         }
-        if (cIdx == -1) {
-            cout << "Course with code " << courseCode << " not found.\n";
-            return;
+        while (!done) {
+            piece.swap(pending);
+            pending.clear();
+            if (frames.next(block)) {
+                piece.append(block);
+                size_t cut = piece.rfind('\n');
+                if (cut == string::npos) {
+                    pending.swap(piece);
+                    continue;
+                }
+                pending.assign(piece, cut + 1, string::npos);
+                piece.resize(cut + 1);
+            } else {
+                done = true;
+                if (piece.empty())
+                    return false;
+            }
+            text = piece;
+            if (!started) {
+                started = true;
+                nextLine(text, header);
+            }
+            return true;
         }
-        // UPDATED: Check if the student is already enrolled in the course.
-        const auto &enrolled = students[sIdx]->getCourses();
-        if (find(enrolled.begin(), enrolled.end(), courseCode) != enrolled.end()) {
-            cout << "Student " << studentID << " is already enrolled in course " << courseCode << ".\n";
+        return false;
+    }
+};
+
+// ----------------------------
+// Class: AtomicFileWriter
+// ----------------------------
+// Collects output in a caller-owned buffer (so it can be reused across
+// exports) and writes it to "<target>.tmp" in large blocks. commit() flushes,
+// syncs and renames the temp file over the target, so a crash mid-export
+// leaves the previous file intact. Without a commit the temp file is removed.
+class AtomicFileWriter {
+private:
+    string target;
+    string temp;
+    string &buffer;
+    string packed;
+    bool compressed = false;
+    Xxh32 content;
+    bool ok = false;
+#if SMS_POSIX
+    int fd = -1;
+#else
+    ofstream file;
+    mutex seekLock;
+#endif
+
+    void writeRaw(string_view bytes) {
+        if (!ok || bytes.empty())
             return;
-        }
-        students[sIdx]->addCourse(courseCode);
-        courses[cIdx].addStudent(studentID);
-        cout << "Enrolled student " << studentID << " in course " << courseCode << "\n";
+#if SMS_POSIX
+        ok = writeFully(fd, bytes.data(), bytes.size());
+#else
+        ok = static_cast<bool>(file.write(bytes.data(), bytes.size()));
+#endif
     }
 
-    void removeStudentFromCourse(const string &studentID, const string &courseCode) {
-        int sIdx = findStudentIndex(studentID);
-        int cIdx = findCourseIndex(courseCode);
-        if (sIdx == -1 || cIdx == -1) {
-            cout << "Either student or course not found.\n";
+    // Data as given, or as LZ4 blocks in compressed mode.
+    void writeData(string_view bytes) {
+        if (!compressed || bytes.empty()) {
+            writeRaw(bytes);
             return;
         }
-        students[sIdx]->removeCourse(courseCode);
-        courses[cIdx].removeStudent(studentID);
-        cout << "Removed student " << studentID << " from course " << courseCode << "\n";
+        content.update(bytes.data(), bytes.size());
+        packed.clear();
+        lz4AppendBlocks(packed, bytes);
+        writeRaw(packed);
     }
 
-    // ----------------------------
-    // Reporting Functions
-    // ----------------------------
-    // Generate report for a given course: displays on terminal and saves as CSV
-    void generateReportForCourse(const string &courseCode) {
-        int cIdx = findCourseIndex(courseCode);
-        if (cIdx == -1) {
-            cout << "Course with code " << courseCode << " not found.\n";
-            return;
+    void closeFile() {
+#if SMS_POSIX
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#else
+        if (file.is_open())
+            file.close();
+#endif
+    }
+
+public:
+    static constexpr size_t kFlushSize = 1 << 20;
+
+    explicit AtomicFileWriter(string &buffer) : buffer(buffer) {}
+
+    ~AtomicFileWriter() {
+        closeFile();
+        if (!temp.empty()) {
+            error_code ec;
+            fs::remove(temp, ec);
         }
-        cout << "\n--- Course Report for " << courseCode << " ---\n";
-        cout << "StudentID,Name,Type\n";
+    }
 
-        string dir = "Reports/CourseReports";
-        ensureDirectory(dir);
-        string filename = dir + "/" + courseCode + ".csv";
-        ofstream file(filename);
-        if (!file) {
-            cout << "Error opening file for report.\n";
-            return;
+    AtomicFileWriter(const AtomicFileWriter &) = delete;
+    AtomicFileWriter &operator=(const AtomicFileWriter &) = delete;
+
+    // With `compress`, the file is one LZ4 frame: buffered and written
+    // data is compressed block by block, and commit() ends the frame. The
+    // temp file is path + suffix; writers that may overlap on one target
+    // need different suffixes.
+    bool open(const string &path, bool compress = false, const char *suffix = ".tmp") {
+        target = path;
+        temp = path + suffix;
+        compressed = compress;
+        content = Xxh32();
+        buffer.clear();
+#if SMS_POSIX
+        fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok = fd >= 0;
+#else
+        file.open(temp, ios::binary | ios::trunc);
+        ok = static_cast<bool>(file);
+#endif
+        if (ok && compressed) {
+            packed.clear();
+            lz4AppendFrameHeader(packed);
+            writeRaw(packed);
         }
-        file << "StudentID,Name,Type\n";
+        return ok;
+    }
 
-        const auto &studentIDs = courses[cIdx].getEnrolledStudents();
-        for (const auto &id : studentIDs) {
-            int sIdx = findStudentIndex(id);
-            if (sIdx != -1) {
-                string line = students[sIdx]->getID() + "," + students[sIdx]->getName() + "," + students[sIdx]->getType();
-                cout << line << "\n";
-                file << line << "\n";
+    // Format directly into out(); call flushIfFull() between rows.
+    string &out() { return buffer; }
+
+    void flushIfFull() {
+        if (buffer.size() >= kFlushSize)
+            flush();
+    }
+
+    void flush() {
+        writeData(buffer);
+        buffer.clear();
+    }
+
+    // Write a large block directly, bypassing the buffer.
+    void write(string_view bytes) {
+        flush();
+        writeData(bytes);
+    }
+
+    // Write bytes at a fixed file offset, as given even in compressed mode
+    // (callers write whole frames). Safe to call from several threads at
+    // once for disjoint ranges; a failure is reported to the caller,
+    // which should then call fail() before commit().
+    bool writeAt(uint64_t offset, string_view bytes) {
+#if SMS_POSIX
+        const char *data = bytes.data();
+        size_t size = bytes.size();
+        while (size > 0) {
+            ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
             }
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
         }
-        file.close();
-        cout << "Course report saved to: " << filename << "\n";
+        return true;
+#else
+        lock_guard<mutex> guard(seekLock);
+        file.seekp(static_cast<streamoff>(offset));
+        return static_cast<bool>(file.write(bytes.data(), bytes.size()));
+#endif
     }
 
-    // Generate report for a specific student: displays on terminal and saves as CSV
-    // UPDATED: Includes student’s own information at the top of the CSV.
-    void generateReportForStudent(const string &studentID) {
-        int sIdx = findStudentIndex(studentID);
-        if (sIdx == -1) {
-            cout << "Student with ID " << studentID << " not found.\n";
-            return;
+    void fail() { ok = false; }
+
+    bool commit() { return sync() && replace(); }
+
+    // commit() in two steps, for callers that pick the moment the target
+    // changes: sync() makes the temp file durable, replace() renames it.
+    bool sync() {
+        flush();
+        if (compressed) {
+            packed.clear();
+            lz4AppendEndMark(packed, content.digest());
+            writeRaw(packed);
         }
+#if SMS_POSIX
+        ok = ok && ::fsync(fd) == 0;
+#else
+        ok = ok && static_cast<bool>(file.flush());
+#endif
+        closeFile();
+        return ok;
+    }
+
+    bool replace() {
+        if (!ok || temp.empty())
+            return false;
+        error_code ec;
+        fs::rename(temp, target, ec);
+        if (ec)
+            return false;
+        temp.clear();
+        return true;
+    }
+};
+
+// ----------------------------
+// Scan Kernels
+// ----------------------------
+// Substring search used by the unindexed search paths. The vector versions
+// test 16 (SSE4.2) or 32 (AVX2) candidate positions per step by comparing
+// the needle's first and last bytes at once, and only compare the full
+// needle where both match. The case-insensitive variant folds ASCII letters
+// with |0x20 inside the comparison, so nothing is copied or lowered first.
+// The best kernel is picked once at runtime from the CPU's features.
+
+inline unsigned char foldAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c | 0x20) : c;
+}
+
+// True if text (length >= needle.size()) starts with needle.
+inline bool matchesAt(const char *text, string_view needle, bool ignoreCase) {
+    if (!ignoreCase)
+        return memcmp(text, needle.data(), needle.size()) == 0;
+    for (size_t i = 0; i < needle.size(); ++i)
+        if (foldAscii(static_cast<unsigned char>(text[i])) != foldAscii(static_cast<unsigned char>(needle[i])))
+            return false;
+    return true;
+}
+
+size_t scanFindScalar(string_view text, string_view needle, bool ignoreCase, size_t from) {
+    if (!ignoreCase)
+        return text.find(needle, from);
+    if (needle.size() > text.size())
+        return string_view::npos;
+    for (size_t i = from; i + needle.size() <= text.size(); ++i)
+        if (matchesAt(text.data() + i, needle, true))
+            return i;
+    return string_view::npos;
+}
+
+#if SMS_X86_SIMD
+// Lane value and OR-mask that make (byte | mask) == value test the needle
+// byte c, case-folded when requested and c is a letter.
+inline void foldedProbe(unsigned char c, bool ignoreCase, char &value, char &mask) {
+    bool letter = ignoreCase && ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'));
+    mask = letter ? 0x20 : 0;
+    value = static_cast<char>(letter ? (c | 0x20) : c);
+}
+
+__attribute__((target("sse4.2")))
+size_t scanFindSse42(string_view text, string_view needle, bool ignoreCase, size_t from) {
+    size_t k = needle.size();
+    if (k == 0 || k > text.size())
+        return scanFindScalar(text, needle, ignoreCase, from);
+    char fv, fm, lv, lm;
+    foldedProbe(static_cast<unsigned char>(needle[0]), ignoreCase, fv, fm);
+    foldedProbe(static_cast<unsigned char>(needle[k - 1]), ignoreCase, lv, lm);
+    const __m128i first = _mm_set1_epi8(fv), firstMask = _mm_set1_epi8(fm);
+    const __m128i last = _mm_set1_epi8(lv), lastMask = _mm_set1_epi8(lm);
+    const char *s = text.data();
+    size_t i = from;
+    for (; i + k - 1 + 16 <= text.size(); i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i + k - 1));
+        __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(a, firstMask), first),
+                                    _mm_cmpeq_epi8(_mm_or_si128(b, lastMask), last));
+        unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        while (bits) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(bits));
+            if (matchesAt(s + i + bit, needle, ignoreCase))
+                return i + bit;
+            bits &= bits - 1;
+        }
+    }
+    return scanFindScalar(text, needle, ignoreCase, i);
+}
+
+__attribute__((target("avx2")))
+size_t scanFindAvx2(string_view text, string_view needle, bool ignoreCase, size_t from) {
+    size_t k = needle.size();
+    if (k == 0 || k > text.size())
+        return scanFindScalar(text, needle, ignoreCase, from);
+    char fv, fm, lv, lm;
+    foldedProbe(static_cast<unsigned char>(needle[0]), ignoreCase, fv, fm);
+    foldedProbe(static_cast<unsigned char>(needle[k - 1]), ignoreCase, lv, lm);
+    const __m256i first = _mm256_set1_epi8(fv), firstMask = _mm256_set1_epi8(fm);
+    const __m256i last = _mm256_set1_epi8(lv), lastMask = _mm256_set1_epi8(lm);
+    const char *s = text.data();
+    size_t i = from;
+    for (; i + k - 1 + 32 <= text.size(); i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i + k - 1));
+        __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(a, firstMask), first),
+                                       _mm256_cmpeq_epi8(_mm256_or_si256(b, lastMask), last));
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        while (bits) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(bits));
+            if (matchesAt(s + i + bit, needle, ignoreCase))
+                return i + bit;
+            bits &= bits - 1;
+        }
+    }
+    return scanFindScalar(text, needle, ignoreCase, i);
+}
+#endif
+
+using ScanFindFn = size_t (*)(string_view, string_view, bool, size_t);
+
+ScanFindFn selectScanKernel() {
+#if SMS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return scanFindAvx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return scanFindSse42;
+#endif
+    return scanFindScalar;
+}
+
+// Position of the first occurrence of needle in text at or after from, or
+// string_view::npos; ignoreCase folds ASCII letters.
+inline size_t scanFind(string_view text, string_view needle, bool ignoreCase = false, size_t from = 0) {
+    static const ScanFindFn kernel = selectScanKernel();
+    if (from > text.size())
+        return string_view::npos;
+    return kernel(text, needle, ignoreCase, from);
+}
+
+// Equality with optional ASCII case folding, without copying either side.
+inline bool textEquals(string_view a, string_view b, bool ignoreCase = false) {
+    return a.size() == b.size() && matchesAt(a.data(), b, ignoreCase);
+}
+
+// ----------------------------
+// Model Allocation
+// ----------------------------
+// The model's node-based containers and many small lists (edge index,
+// intern maps, adjacency lists) are std::pmr containers, each constructed
+// on modelMemory(). Normally that is plain new/delete. In arena mode it is
+// a pool over one monotonic arena: records are carved out of a few large
+// blocks, freed nodes are reused from the pool's free lists, and the blocks
+// go back in one piece at exit instead of one free() per node.
+//
+// The pool is unsynchronized (the locked variant cost more than it saved).
+// It is handed to the model's containers only, never installed as the
+// process-wide default, so loader and server threads cannot reach it; model
+// memory itself may only be allocated or freed with writers excluded, and
+// that includes releasing a pinned version.
+pmr::memory_resource *&modelMemory() {
+    static pmr::memory_resource *resource = pmr::new_delete_resource();
+    return resource;
+}
+
+// Switch the model to the arena. Call before the first model is constructed.
+void useModelArena() {
+    static pmr::monotonic_buffer_resource arena(size_t(1) << 20);
+    static pmr::unsynchronized_pool_resource pool(&arena);
+    modelMemory() = &pool;
+}
+
+// ----------------------------
+// Operation Metrics
+// ----------------------------
+// Call counts and latency histograms for each public operation and each
+// load, export and persistence phase. Every thread records into its own
+// shard with plain (relaxed) stores, so the hot path never contends; a dump
+// sums the shards. Shards of exited threads are folded into a retired total.
+// The histograms are log-linear in the style of HDR histograms: 16
+// sub-buckets per power of two of nanoseconds, so a reported quantile is
+// within 1/16 of the recorded value. Collection is off by default, and an
+// OpTimer then costs one relaxed load and never reads the clock.
+enum class Op : uint8_t {
+    AddStudent, RemoveStudent, AddCourse, RemoveCourse,
+    Enroll, Unenroll, EnrollBatch, SetCapacity,
+    Search, ListStudents, ListCourses, ReportCourse, ReportStudent, ReportAll, Analytics,
+    ExportStudents, ExportCourses, ExportParallel, ExportDelta,
+    LoadStudents, LoadCourses, LoadParse, LoadMerge, Import, Generate,
+    SnapshotSave, SnapshotLoad, LogReplay, LogCommit, Checkpoint,
+    Count
+};
+
+const char *opName(Op op) {
+    static const char *const names[] = {
+        "add_student", "remove_student", "add_course", "remove_course",
+        "enroll", "unenroll", "enroll_batch", "set_capacity",
+        "search", "list_students", "list_courses", "report_course", "report_student", "report_all", "analytics",
+        "export_students", "export_courses", "export_parallel", "export_delta",
+        "load_students", "load_courses", "load_parse", "load_merge", "import", "generate",
+        "snapshot_save", "snapshot_load", "log_replay", "log_commit", "checkpoint"};
+    static_assert(size(names) == size_t(Op::Count), "one name per Op");
+    return names[size_t(op)];
+}
+
+class Metrics {
+public:
+    static constexpr size_t kOps = size_t(Op::Count);
+    static constexpr unsigned kSubBits = 4;
+    static constexpr size_t kSub = size_t(1) << kSubBits;
+    // Values from 2^40 ns (about 18 minutes) up share the last bucket.
+    static constexpr size_t kBuckets = (40 - kSubBits + 1) * kSub;
+
+    static bool enabled() { return flag().load(memory_order_relaxed); }
+    static void enable(bool on = true) { flag().store(on, memory_order_relaxed); }
+
+    static void record(Op op, uint64_t ns) {
+        OpStats &s = localShard().ops[size_t(op)];
+        bump(s.count, 1);
+        bump(s.sumNs, ns);
+        if (ns > s.maxNs.load(memory_order_relaxed))
+            s.maxNs.store(ns, memory_order_relaxed);
+        bump(s.buckets[bucketOf(ns)], 1);
+    }
+
+    // Bucket i < kSub holds exactly i ns. Above that, bucket g * kSub + sub
+    // covers [(kSub + sub) << (g - 1), ((kSub + sub + 1) << (g - 1)) - 1].
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < kSub)
+            return size_t(ns);
+        unsigned top = 63;
+#if defined(__GNUC__)
+        top = 63 - unsigned(__builtin_clzll(ns));
+#else
+        while (!(ns >> top))
+            --top;
+#endif
+        size_t g = top - kSubBits + 1;
+        size_t idx = g * kSub + size_t((ns >> (top - kSubBits)) & (kSub - 1));
+        return min(idx, kBuckets - 1);
+    }
+
+    static uint64_t bucketUpperBound(size_t idx) {
+        if (idx < kSub)
+            return idx;
+        size_t g = idx / kSub, sub = idx % kSub;
+        return ((uint64_t(kSub + sub + 1)) << (g - 1)) - 1;
+    }
+
+    // Everything recorded so far in the Prometheus text exposition format:
+    // a call counter, a latency summary (p50/p90/p99/p999) and the maximum
+    // per operation. Operations that never ran are left out.
+    static string prometheusText() {
+        vector<Totals> totals = collect();
+        ostringstream out;
+        out << "# HELP sms_operations_total Operations completed.\n"
+               "# TYPE sms_operations_total counter\n";
+        for (size_t op = 0; op < kOps; ++op)
+            if (totals[op].count)
+                out << "sms_operations_total{op=\"" << opName(Op(op)) << "\"} " << totals[op].count << "\n";
+        out << "# HELP sms_operation_duration_seconds Operation latency.\n"
+               "# TYPE sms_operation_duration_seconds summary\n";
+        const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        for (size_t op = 0; op < kOps; ++op) {
+            const Totals &t = totals[op];
+            if (!t.count)
+                continue;
+            const char *name = opName(Op(op));
+            for (double q : quantiles)
+                out << "sms_operation_duration_seconds{op=\"" << name << "\",quantile=\"" << q << "\"} "
+                    << seconds(min(t.maxNs, quantile(t, q))) << "\n";
+            out << "sms_operation_duration_seconds_sum{op=\"" << name << "\"} " << seconds(t.sumNs) << "\n"
+                << "sms_operation_duration_seconds_count{op=\"" << name << "\"} " << t.count << "\n";
+        }
+        out << "# HELP sms_operation_duration_seconds_max Slowest call so far.\n"
+               "# TYPE sms_operation_duration_seconds_max gauge\n";
+        for (size_t op = 0; op < kOps; ++op)
+            if (totals[op].count)
+                out << "sms_operation_duration_seconds_max{op=\"" << opName(Op(op)) << "\"} "
+                    << seconds(totals[op].maxNs) << "\n";
+        return out.str();
+    }
+
+private:
+    struct OpStats {
+        atomic<uint64_t> count{0}, sumNs{0}, maxNs{0};
+        atomic<uint64_t> buckets[kBuckets]{};
+    };
+
+    struct Shard {
+        OpStats ops[kOps];
+    };
+
+    struct Totals {
+        uint64_t count = 0, sumNs = 0, maxNs = 0;
+        vector<uint64_t> buckets = vector<uint64_t>(kBuckets);
+    };
+
+    // Live shards, plus the sum of shards whose threads have exited.
+    struct Registry {
+        mutex lock;
+        vector<Shard *> live;
+        vector<Totals> retired = vector<Totals>(kOps);
+    };
+
+    // Frees the thread's shard when the thread exits.
+    struct ShardOwner {
+        Shard *shard = nullptr;
+        ~ShardOwner() {
+            if (!shard)
+                return;
+            Registry &r = registry();
+            lock_guard<mutex> guard(r.lock);
+            addInto(r.retired, *shard);
+            r.live.erase(find(r.live.begin(), r.live.end(), shard));
+            delete shard;
+        }
+    };
+
+    static atomic<bool> &flag() {
+        static atomic<bool> on{false};
+        return on;
+    }
+
+    static Registry &registry() {
+        static Registry r;
+        return r;
+    }
+
+    // Only the owning thread writes a shard, so a relaxed load and store
+    // is enough; readers may see a slightly stale count.
+    static void bump(atomic<uint64_t> &a, uint64_t by) {
+        a.store(a.load(memory_order_relaxed) + by, memory_order_relaxed);
+    }
+
+    static Shard &localShard() {
+        thread_local ShardOwner owner;
+        if (!owner.shard) {
+            owner.shard = new Shard();
+            Registry &r = registry();
+            lock_guard<mutex> guard(r.lock);
+            r.live.push_back(owner.shard);
+        }
+        return *owner.shard;
+    }
+
+    static void addInto(vector<Totals> &totals, const Shard &shard) {
+        for (size_t op = 0; op < kOps; ++op) {
+            const OpStats &s = shard.ops[op];
+            Totals &t = totals[op];
+            t.count += s.count.load(memory_order_relaxed);
+            t.sumNs += s.sumNs.load(memory_order_relaxed);
+            t.maxNs = max(t.maxNs, s.maxNs.load(memory_order_relaxed));
+            for (size_t i = 0; i < kBuckets; ++i)
+                t.buckets[i] += s.buckets[i].load(memory_order_relaxed);
+        }
+    }
+
+    static vector<Totals> collect() {
+        Registry &r = registry();
+        lock_guard<mutex> guard(r.lock);
+        vector<Totals> totals = r.retired;
+        for (const Shard *shard : r.live)
+            addInto(totals, *shard);
+        return totals;
+    }
+
+    // Upper bound of the bucket holding the ceil(q * count)-th value.
+    static uint64_t quantile(const Totals &t, double q) {
+        uint64_t rank = max<uint64_t>(1, uint64_t(q * double(t.count) + 0.999999));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i)
+            if ((seen += t.buckets[i]) >= rank)
+                return bucketUpperBound(i);
+        return t.maxNs;
+    }
+
+    static double seconds(uint64_t ns) { return double(ns) / 1e9; }
+};
+
+// Records the time from construction to destruction against one Op.
+class OpTimer {
+private:
+    Op op;
+    bool active;
+    chrono::steady_clock::time_point start;
+public:
+    explicit OpTimer(Op op) : op(op), active(Metrics::enabled()) {
+        if (active)
+            start = chrono::steady_clock::now();
+    }
+    ~OpTimer() {
+        if (active)
+            Metrics::record(op, uint64_t(chrono::duration_cast<chrono::nanoseconds>(
+                                    chrono::steady_clock::now() - start).count()));
+    }
+    OpTimer(const OpTimer &) = delete;
+    OpTimer &operator=(const OpTimer &) = delete;
+};
+
+// ----------------------------
+// Class: CowVector
+// ----------------------------
+// Vector split into fixed-size chunks held by shared_ptr. Copying copies
+// only the chunk pointers; the first write to a chunk that is still shared
+// with a copy clones that one chunk. This is what lets a pinned model
+// version share everything a writer has not touched since it was taken.
+template <typename T, size_t kChunkBits = 6>
+class CowVector {
+private:
+    static constexpr size_t kChunk = size_t(1) << kChunkBits;
+
+    vector<shared_ptr<vector<T>>> chunks; // all but the last are full
+    size_t count = 0;
+
+    vector<T> &own(size_t c) {
+        if (chunks[c].use_count() > 1)
+            clone(c);
+        return *chunks[c];
+    }
+
+    void clone(size_t c) {
+        auto copy = make_shared<vector<T>>();
+        copy->reserve(kChunk);
+        copy->assign(chunks[c]->begin(), chunks[c]->end());
+        chunks[c] = move(copy);
+    }
+
+public:
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const T &operator[](size_t i) const { return (*chunks[i >> kChunkBits])[i & (kChunk - 1)]; }
+
+    // Writable element; clones its chunk first if a copy still shares it.
+    T &edit(size_t i) { return own(i >> kChunkBits)[i & (kChunk - 1)]; }
+
+    // edit() for loops of writes that mostly stay in one chunk: the chunk
+    // is only made writable again when the index leaves it. Valid until
+    // the vector changes size.
+    class Editor {
+    private:
+        CowVector &v;
+        size_t chunk = numeric_limits<size_t>::max();
+        T *base = nullptr;
+    public:
+        explicit Editor(CowVector &v) : v(v) {}
+        T &operator[](size_t i) {
+            if ((i >> kChunkBits) != chunk) {
+                chunk = i >> kChunkBits;
+                base = v.own(chunk).data();
+            }
+            return base[i & (kChunk - 1)];
+        }
+    };
+
+    void push_back(T value) {
+        if (count % kChunk == 0) {
+            chunks.push_back(make_shared<vector<T>>());
+            chunks.back()->reserve(kChunk);
+        }
+        own(chunks.size() - 1).push_back(move(value));
+        count++;
+    }
+
+    // Remove element i; later elements shift down by one. Only the chunks
+    // from i's onwards are written.
+    void erase(size_t i) {
+        for (size_t c = i >> kChunkBits; c < chunks.size(); ++c) {
+            vector<T> &chunk = own(c);
+            chunk.erase(chunk.begin() + (c == (i >> kChunkBits) ? (i & (kChunk - 1)) : 0));
+            if (c + 1 < chunks.size())
+                chunk.push_back(chunks[c + 1]->front());
+        }
+        if (chunks.back()->empty())
+            chunks.pop_back();
+        count--;
+    }
+
+    void resize(size_t n, const T &value = T()) {
+        while (count < n)
+            push_back(value);
+        if (n < count) {
+            chunks.resize((n + kChunk - 1) / kChunk);
+            if (n % kChunk)
+                own(chunks.size() - 1).resize(n % kChunk);
+            count = n;
+        }
+    }
+
+    void assign(const vector<T> &values) {
+        clear();
+        for (size_t first = 0; first < values.size(); first += kChunk) {
+            chunks.push_back(make_shared<vector<T>>());
+            chunks.back()->reserve(kChunk);
+            chunks.back()->assign(values.begin() + first, values.begin() + min(values.size(), first + kChunk));
+        }
+        count = values.size();
+    }
+
+    void clear() {
+        chunks.clear();
+        count = 0;
+    }
+};
+
+// ----------------------------
+// Class: InternTable
+// ----------------------------
+// Maps strings such as student IDs and course codes to dense uint32_t
+// handles. The text is stored once in large blocks owned by the table, so
+// the rest of the model can pass 4-byte handles around and only turn them
+// back into text for output. Lookups take a string_view and never allocate.
+//
+// A table can be given a packer that turns most of its strings into a
+// fixed-width integer key (student IDs, see packStudentID). Those strings
+// are looked up by integer hash instead of by text, and less() compares
+// two of them with one integer comparison.
+class InternTable {
+public:
+    using Packer = bool (*)(string_view, uint64_t &);
+    static constexpr uint64_t kUnpacked = numeric_limits<uint64_t>::max();
+
+private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    // The text blocks are shared with copies: bytes are only ever appended
+    // past the end a copy knows about, so its views stay valid. The
+    // handle columns are copy-on-write by chunk.
+    vector<shared_ptr<char[]>> blocks;
+    size_t blockUsed = 0;
+    size_t blockCap = 0;
+    CowVector<string_view, 12> texts;                  // handle -> text
+    CowVector<uint64_t, 12> keys;                      // handle -> packed key (packer only)
+    pmr::unordered_map<string_view, uint32_t> handles{modelMemory()}; // text -> handle, unpacked text
+    pmr::unordered_map<uint64_t, uint32_t> packed{modelMemory()};     // packed key -> handle
+    Packer packer = nullptr;
+
+    string_view store(string_view s) {
+        if (s.size() > blockCap - blockUsed) {
+            blockCap = max(kBlockSize, s.size());
+            blocks.push_back(shared_ptr<char[]>(new char[blockCap]));
+            blockUsed = 0;
+        }
+        char *dst = blocks.back().get() + blockUsed;
+        copy(s.begin(), s.end(), dst);
+        blockUsed += s.size();
+        return string_view(dst, s.size());
+    }
+
+public:
+    static constexpr uint32_t npos = numeric_limits<uint32_t>::max();
+
+    explicit InternTable(Packer packer = nullptr) : packer(packer) {}
+
+    // A copy turns handles back into text but gets no lookup maps, so it
+    // must not find() or intern(); it is the read-only view a pinned model
+    // version needs. Like EnrollmentGraph's edge index, the maps stay with
+    // the live table.
+    InternTable(const InternTable &other)
+        : blocks(other.blocks), texts(other.texts), keys(other.keys), packer(other.packer) {}
+    InternTable &operator=(const InternTable &) = delete;
+
+    // Return the handle for s, adding it to the table if it is new.
+    uint32_t intern(string_view s) {
+        uint64_t key = kUnpacked;
+        if (packer && packer(s, key)) {
+            auto it = packed.find(key);
+            if (it != packed.end())
+                return it->second;
+        } else {
+            auto it = handles.find(s);
+            if (it != handles.end())
+                return it->second;
+        }
+        string_view stored = store(s);
+        uint32_t h = static_cast<uint32_t>(texts.size());
+        texts.push_back(stored);
+        if (packer)
+            keys.push_back(key);
+        if (key != kUnpacked)
+            packed.emplace(key, h);
+        else
+            handles.emplace(stored, h);
+        return h;
+    }
+
+    // Return the handle for s, or npos if it was never interned.
+    uint32_t find(string_view s) const {
+        uint64_t key;
+        if (packer && packer(s, key)) {
+            auto it = packed.find(key);
+            return it == packed.end() ? npos : it->second;
+        }
+        auto it = handles.find(s);
+        return it == handles.end() ? npos : it->second;
+    }
+
+    string_view str(uint32_t h) const { return texts[h]; }
+    size_t size() const { return texts.size(); }
+
+    // Packed key of a handle, kUnpacked if it has none.
+    uint64_t key(uint32_t h) const { return packer ? keys[h] : kUnpacked; }
+
+    // Text order of two handles, by packed key when both have one.
+    bool less(uint32_t a, uint32_t b) const {
+        uint64_t ka = key(a), kb = key(b);
+        if (ka != kUnpacked && kb != kUnpacked)
+            return ka < kb;
+        return str(a) < str(b);
+    }
+};
+
+// ----------------------------
+// Student Type
+// ----------------------------
+// Undergraduate and Postgraduate students differ only in their type label,
+// so the type is stored as a one-byte tag instead of a class hierarchy.
+enum class StudentType : uint8_t {
+    Undergraduate,
+    Postgraduate
+};
+
+const char *studentTypeName(StudentType type) {
+    return type == StudentType::Undergraduate ? "Undergraduate" : "Postgraduate";
+}
+
+// Parse a type label; returns false for anything but the two known types.
+bool parseStudentType(string_view text, StudentType &type) {
+    if (text == "Undergraduate")
+        type = StudentType::Undergraduate;
+    else if (text == "Postgraduate")
+        type = StudentType::Postgraduate;
+    else
+        return false;
+    return true;
+}
+
+// ----------------------------
+// Class: StudentTable
+// ----------------------------
+// Column-oriented student storage. Row i is described by ids[i], types[i]
+// and the name bytes at nameOffsets[i]/nameLengths[i]. Rows stay in
+// insertion order and name offsets grow with the row number, so a full
+// scan walks each column front to back. Erasing a row leaves its name
+// bytes behind; the names are compacted once most of them are dead.
+// Offsets are 64-bit so the names can grow past 4 GiB.
+//
+// Name offsets run first over bytes read in place from a mapped snapshot
+// (mappedNames, see assignMapped) and then over the owned names, which are
+// kept in kNameBlock-sized blocks. A name never straddles two allocations:
+// one that does not fit in what is left of the last block starts a new
+// one (the skipped tail counts as dead), and one longer than a block gets
+// enough consecutive blocks from a single allocation.
+//
+// Copies share everything. The columns are CowVectors and name bytes are
+// only ever appended past the end a copy knows about, so a pinned version
+// costs a few pointers per 4096 rows and a later write clones only the
+// chunks it touches. Compaction writes new blocks and leaves the old ones
+// to the copies.
+class StudentTable {
+private:
+    static constexpr size_t kNameBlockBits = 16;
+    static constexpr size_t kNameBlock = size_t(1) << kNameBlockBits;
+
+    struct Names {
+        string_view mapped;
+        const SnapshotPages *pages = nullptr; // verifies mapped reads
+        vector<shared_ptr<char[]>> blocks; // block b holds owned bytes from b * kNameBlock
+        size_t owned = 0;                  // owned bytes in use, skipped tails included
+
+        size_t size() const { return mapped.size() + owned; }
+
+        string_view at(uint64_t offset, size_t length) const {
+            if (length == 0)
+                return string_view();
+            if (offset < mapped.size())
+                return pages->verify(mapped.data() + offset, length) ? string_view(mapped.data() + offset, length)
+                                                                     : string_view();
+            offset -= mapped.size();
+            return string_view(blocks[offset >> kNameBlockBits].get() + (offset & (kNameBlock - 1)), length);
+        }
+
+        // Append a name and return its offset; bytes skipped to keep it in
+        // one allocation are added to dead.
+        uint64_t append(string_view name, size_t &dead) {
+            size_t capacity = blocks.size() * kNameBlock;
+            if (name.size() > capacity - owned) {
+                dead += capacity - owned;
+                owned = capacity;
+                size_t count = (name.size() + kNameBlock - 1) / kNameBlock;
+                shared_ptr<char[]> bytes(new char[count * kNameBlock]);
+                for (size_t i = 0; i < count; ++i)
+                    blocks.push_back(shared_ptr<char[]>(bytes, bytes.get() + i * kNameBlock));
+            }
+            uint64_t offset = size();
+            if (!name.empty())
+                copy(name.begin(), name.end(), blocks[owned >> kNameBlockBits].get() + (owned & (kNameBlock - 1)));
+            owned += name.size();
+            return offset;
+        }
+
+        // Call fn(region, start) for the mapped bytes (unless damaged) and
+        // for each run of owned blocks in one allocation; start is the
+        // region's offset.
+        template <typename Fn>
+        void forEachRegion(Fn fn) const {
+            if (!mapped.empty() && pages->verify(mapped.data(), mapped.size()))
+                fn(mapped, size_t(0));
+            for (size_t b = 0, used = owned; b < blocks.size() && b * kNameBlock < used;) {
+                size_t run = 1;
+                while (b + run < blocks.size() && blocks[b + run].get() == blocks[b].get() + run * kNameBlock)
+                    run++;
+                size_t begin = b * kNameBlock, end = min(used, (b + run) * kNameBlock);
+                fn(string_view(blocks[b].get(), end - begin), mapped.size() + begin);
+                b += run;
+            }
+        }
+    };
+
+    CowVector<uint32_t, 12> ids;         // interned student ID handle
+    CowVector<uint64_t, 12> nameOffsets;
+    CowVector<uint32_t, 12> nameLengths;
+    CowVector<StudentType, 12> types;
+    Names names;
+    size_t deadNameBytes = 0;
+
+    void compactNames() {
+        Names packed;
+        size_t skipped = 0;
+        for (size_t row = 0; row < ids.size(); ++row)
+            nameOffsets.edit(row) = packed.append(name(row), skipped);
+        names = move(packed);
+        deadNameBytes = skipped;
+    }
+
+public:
+    size_t size() const { return ids.size(); }
+    uint32_t id(size_t row) const { return ids[row]; }
+    StudentType type(size_t row) const { return types[row]; }
+    string_view name(size_t row) const { return names.at(nameOffsets[row], nameLengths[row]); }
+
+    void append(uint32_t id, string_view name, StudentType type) {
+        ids.push_back(id);
+        nameOffsets.push_back(names.append(name, deadNameBytes));
+        nameLengths.push_back(static_cast<uint32_t>(name.size()));
+        types.push_back(type);
+    }
+
+    // Replace the table with columns whose names lie in `mappedNames`, read
+    // in place and verified through `pages`; both must outlive the table
+    // and its copies. Every name slice must fit in `mappedNames`.
+    void assignMapped(const SnapshotPages &pages, string_view mappedNames, const vector<uint32_t> &rowIDs,
+                      const vector<uint64_t> &rowOffsets, const vector<uint32_t> &rowLengths,
+                      const vector<StudentType> &rowTypes) {
+        ids.assign(rowIDs);
+        nameOffsets.assign(rowOffsets);
+        nameLengths.assign(rowLengths);
+        types.assign(rowTypes);
+        names = Names();
+        names.mapped = mappedNames;
+        names.pages = &pages;
+        deadNameBytes = 0;
+    }
+
+    // Call fn(row) once for every row whose name contains needle, in row
+    // order. The name bytes are scanned region by region with the vector
+    // kernel; a hit is mapped back to its row by binary search on the
+    // (ascending) name offsets and dropped if it lies in dead bytes or
+    // straddles two names.
+    template <typename Fn>
+    void forEachNameMatch(string_view needle, bool ignoreCase, Fn fn) const {
+        if (needle.empty()) {
+            for (size_t row = 0; row < ids.size(); ++row)
+                fn(row);
+            return;
+        }
+        names.forEachRegion([&](string_view region, size_t start) {
+            size_t pos = 0;
+            while ((pos = scanFind(region, needle, ignoreCase, pos)) != string_view::npos) {
+                size_t at = start + pos;
+                // First row whose name starts after the hit.
+                size_t lo = 0, hi = nameOffsets.size();
+                while (lo < hi) {
+                    size_t mid = lo + (hi - lo) / 2;
+                    if (nameOffsets[mid] <= at)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                if (lo == 0) {
+                    ++pos;
+                    continue;
+                }
+                size_t row = lo - 1;
+                size_t end = static_cast<size_t>(nameOffsets[row]) + nameLengths[row];
+                if (at + needle.size() <= end) {
+                    fn(row);
+                    pos = end - start; // one hit per row is enough
+                } else {
+                    ++pos;
+                }
+            }
+        });
+    }
+
+    // Remove a row; later rows shift down by one.
+    void erase(size_t row) {
+        deadNameBytes += nameLengths[row];
+        ids.erase(row);
+        nameOffsets.erase(row);
+        nameLengths.erase(row);
+        types.erase(row);
+        if (deadNameBytes > 4096 && deadNameBytes * 2 > names.size())
+            compactNames();
+    }
+};
+
+// ----------------------------
+// Class: Course
+// ----------------------------
+class Course {
+private:
+    string courseName;
+    uint32_t courseCode;  // handle into StudentManagement's course code table
+public:
+    Course(string_view courseName, uint32_t courseCode)
+        : courseName(courseName), courseCode(courseCode) {}
+
+    const string &getCourseName() const { return courseName; }
+    uint32_t getCourseCode() const { return courseCode; }
+};
+
+// ----------------------------
+// Class: EnrollmentGraph
+// ----------------------------
+// Central student <-> course enrollment store over interned student and
+// course handles. Each handle owns an adjacency list and every edge is
+// mirrored on the other side, so both directions can be walked without
+// searching. The edge map gives O(1) membership and remembers where the edge
+// sits in both lists, so removal just vacates those two slots; a list is
+// compacted once it is mostly vacant. Enrollment order is kept.
+//
+// The adjacency lists live in CowVector chunks, so copying the graph is
+// cheap and the copy keeps seeing the lists as they were while the
+// original goes on changing. A copy does not get the edge index: it is a
+// read-only view for forEach*/flatten*, used by pinned model versions.
+//
+// A graph can also read both sides in place from the CSR arrays of a
+// mapped snapshot (assignMapped), so a list costs nothing until it is
+// walked. The first change copies the arrays into adjacency lists and
+// builds the edge index, as assign() would.
+class EnrollmentGraph {
+private:
+    static constexpr uint32_t kVacant = numeric_limits<uint32_t>::max();
+
+    struct Adjacency {
+        pmr::vector<uint32_t> slots{modelMemory()}; // neighbour handles, kVacant for removed edges
+        uint32_t live = 0;
+
+        Adjacency() = default;
+        // A pmr copy would fall back to the default resource; chunk clones
+        // keep their lists on the model's.
+        Adjacency(const Adjacency &other) : slots(other.slots, modelMemory()), live(other.live) {}
+        Adjacency(Adjacency &&) = default;
+        Adjacency &operator=(const Adjacency &) = default;
+        Adjacency &operator=(Adjacency &&) = default;
+    };
+
+    // One side as mapped CSR arrays. They may be unaligned, so entries are
+    // read with memcpy. Each read verifies its chunks first, and a list in
+    // a damaged chunk reads as empty; reads are clamped as well, since the
+    // arrays' layout is not checked up front.
+    struct MappedSide {
+        const SnapshotPages *pages = nullptr;
+        const char *offsets = nullptr; // count + 1 entries
+        const char *edges = nullptr;   // edgeCount entries
+        size_t count = 0;
+        size_t edgeCount = 0;
+        uint32_t limit = 0;            // neighbour handles are below this
+
+        static uint32_t load(const char *p, size_t i) {
+            uint32_t value;
+            memcpy(&value, p + 4 * i, 4);
+            return value;
+        }
+
+        // Edge range [first, last) of handle h; false if h has none.
+        bool range(uint32_t h, size_t &first, size_t &last) const {
+            if (h >= count || !pages->verify(offsets + 4 * size_t(h), 8))
+                return false;
+            last = min<size_t>(load(offsets, h + 1), edgeCount);
+            first = min<size_t>(load(offsets, h), last);
+            return pages->verify(edges + 4 * first, 4 * (last - first));
+        }
+
+        uint32_t size(uint32_t h) const {
+            size_t first, last;
+            return range(h, first, last) ? static_cast<uint32_t>(last - first) : 0;
+        }
+
+        // Call fn(neighbour) for each edge of h until it returns false.
+        template <typename Fn>
+        bool visit(uint32_t h, Fn fn) const {
+            size_t first, last;
+            if (!range(h, first, last))
+                return true;
+            for (size_t i = first; i < last; ++i) {
+                uint32_t n = load(edges, i);
+                if (n < limit && !fn(n))
+                    return false;
+            }
+            return true;
+        }
+
+        void flatten(size_t total, vector<uint32_t> &outOffsets, vector<uint32_t> &outEdges) const {
+            outOffsets.assign(1, 0);
+            outEdges.clear();
+            outEdges.reserve(edgeCount);
+            for (size_t h = 0; h < total; ++h) {
+                visit(static_cast<uint32_t>(h), [&](uint32_t n) {
+                    outEdges.push_back(n);
+                    return true;
+                });
+                outOffsets.push_back(static_cast<uint32_t>(outEdges.size()));
+            }
+        }
+    };
+
+    MappedSide mappedCourses;  // student handle -> course handles
+    MappedSide mappedStudents; // course handle -> student handles
+    bool mapped = false;       // the lists are still the mapped arrays
+
+    CowVector<Adjacency> coursesOf;   // student handle -> course handles
+    CowVector<Adjacency> studentsOf;  // course handle -> student handles
+    // (student, course) -> (slot in coursesOf[student], slot in studentsOf[course])
+    pmr::unordered_map<uint64_t, pair<uint32_t, uint32_t>> edgeSlots{modelMemory()};
+
+    static uint64_t edgeKey(uint32_t s, uint32_t c) {
+        return (static_cast<uint64_t>(s) << 32) | c;
+    }
+
+    static Adjacency &grow(CowVector<Adjacency> &lists, uint32_t h) {
+        if (h >= lists.size())
+            lists.resize(h + 1);
+        return lists.edit(h);
+    }
+
+    static const pmr::vector<uint32_t> *slotsOf(const CowVector<Adjacency> &lists, uint32_t h) {
+        return h < lists.size() ? &lists[h].slots : nullptr;
+    }
+
+    // Copy the mapped arrays into lists; called before every change.
+    void materialize() {
+        if (!mapped)
+            return;
+        vector<uint32_t> courseOffsets, courseEdges, studentOffsets, studentEdges;
+        mappedCourses.flatten(mappedCourses.count, courseOffsets, courseEdges);
+        mappedStudents.flatten(mappedStudents.count, studentOffsets, studentEdges);
+        if (mappedCourses.pages->damaged())
+            keepCommonEdges(courseOffsets, courseEdges, studentOffsets, studentEdges);
+        assign(courseOffsets, courseEdges, studentOffsets, studentEdges);
+    }
+
+    // Lists in damaged chunks read as empty, which can leave an edge on
+    // one side only; drop those, since assign() needs both sides to agree.
+    static void keepCommonEdges(vector<uint32_t> &courseOffsets, vector<uint32_t> &courseEdges,
+                                vector<uint32_t> &studentOffsets, vector<uint32_t> &studentEdges) {
+        auto has = [](const vector<uint64_t> &keys, uint64_t key) {
+            return binary_search(keys.begin(), keys.end(), key);
+        };
+        vector<uint64_t> inCourses, inBoth;
+        for (uint32_t s = 0; s + 1 < courseOffsets.size(); ++s)
+            for (uint32_t i = courseOffsets[s]; i < courseOffsets[s + 1]; ++i)
+                inCourses.push_back(edgeKey(s, courseEdges[i]));
+        sort(inCourses.begin(), inCourses.end());
+        for (uint32_t c = 0; c + 1 < studentOffsets.size(); ++c)
+            for (uint32_t i = studentOffsets[c]; i < studentOffsets[c + 1]; ++i)
+                if (has(inCourses, edgeKey(studentEdges[i], c)))
+                    inBoth.push_back(edgeKey(studentEdges[i], c));
+        sort(inBoth.begin(), inBoth.end());
+        auto filter = [&has, &inBoth](vector<uint32_t> &offsets, vector<uint32_t> &edges, bool byStudent) {
+            size_t kept = 0;
+            for (uint32_t h = 0; h + 1 < offsets.size(); ++h) {
+                uint32_t first = offsets[h], last = offsets[h + 1];
+                offsets[h] = static_cast<uint32_t>(kept);
+                for (uint32_t i = first; i < last; ++i)
+                    if (has(inBoth, byStudent ? edgeKey(h, edges[i]) : edgeKey(edges[i], h)))
+                        edges[kept++] = edges[i];
+            }
+            offsets.back() = static_cast<uint32_t>(kept);
+            edges.resize(kept);
+        };
+        filter(courseOffsets, courseEdges, true);
+        filter(studentOffsets, studentEdges, false);
+    }
+
+    static void flatten(const CowVector<Adjacency> &lists, size_t count,
+                        vector<uint32_t> &offsets, vector<uint32_t> &edges) {
+        offsets.assign(1, 0);
+        edges.clear();
+        for (size_t h = 0; h < count; ++h) {
+            if (h < lists.size())
+                for (uint32_t n : lists[h].slots)
+                    if (n != kVacant)
+                        edges.push_back(n);
+            offsets.push_back(static_cast<uint32_t>(edges.size()));
+        }
+    }
+
+    // Drop vacant slots once they outnumber live ones and re-point the edges.
+    void compactStudent(uint32_t s) {
+        const Adjacency &current = coursesOf[s];
+        if (current.slots.size() < 8 || current.live * 2 > current.slots.size())
+            return;
+        Adjacency &adj = coursesOf.edit(s);
+        uint32_t w = 0;
+        for (uint32_t c : adj.slots) {
+            if (c == kVacant) continue;
+            edgeSlots[edgeKey(s, c)].first = w;
+            adj.slots[w++] = c;
+        }
+        adj.slots.resize(w);
+    }
+
+    void compactCourse(uint32_t c) {
+        const Adjacency &current = studentsOf[c];
+        if (current.slots.size() < 8 || current.live * 2 > current.slots.size())
+            return;
+        Adjacency &adj = studentsOf.edit(c);
+        uint32_t w = 0;
+        for (uint32_t s : adj.slots) {
+            if (s == kVacant) continue;
+            edgeSlots[edgeKey(s, c)].second = w;
+            adj.slots[w++] = s;
+        }
+        adj.slots.resize(w);
+    }
+
+public:
+    EnrollmentGraph() = default;
+    EnrollmentGraph(const EnrollmentGraph &other)
+        : mappedCourses(other.mappedCourses), mappedStudents(other.mappedStudents), mapped(other.mapped),
+          coursesOf(other.coursesOf), studentsOf(other.studentsOf) {}
+    EnrollmentGraph &operator=(const EnrollmentGraph &) = delete;
+
+    bool contains(uint32_t s, uint32_t c) const {
+        if (mapped)
+            return !mappedCourses.visit(s, [c](uint32_t n) { return n != c; });
+        return edgeSlots.count(edgeKey(s, c)) != 0;
+    }
+
+    // Students currently enrolled in course c.
+    uint32_t studentCount(uint32_t c) const {
+        if (mapped)
+            return mappedStudents.size(c);
+        return c < studentsOf.size() ? studentsOf[c].live : 0;
+    }
+
+    // Courses student s is currently enrolled in.
+    uint32_t courseCount(uint32_t s) const {
+        if (mapped)
+            return mappedCourses.size(s);
+        return s < coursesOf.size() ? coursesOf[s].live : 0;
+    }
+
+    // Returns false if the edge already exists.
+    bool link(uint32_t s, uint32_t c) {
+        materialize();
+        Adjacency &courseList = grow(coursesOf, s);
+        Adjacency &studentList = grow(studentsOf, c);
+        auto inserted = edgeSlots.emplace(edgeKey(s, c), make_pair(
+            static_cast<uint32_t>(courseList.slots.size()),
+            static_cast<uint32_t>(studentList.slots.size())));
+        if (!inserted.second)
+            return false;
+        courseList.slots.push_back(c);
+        courseList.live++;
+        studentList.slots.push_back(s);
+        studentList.live++;
+        return true;
+    }
+
+    // Add a batch of edges, none of which may exist yet. Every touched list
+    // is reserved once for its share of the batch before anything is linked.
+    void linkAll(const vector<pair<uint32_t, uint32_t>> &edges) {
+        materialize();
+        vector<uint32_t> perStudent, perCourse;
+        for (const auto &e : edges) {
+            if (e.first >= perStudent.size()) perStudent.resize(e.first + 1, 0);
+            if (e.second >= perCourse.size()) perCourse.resize(e.second + 1, 0);
+            perStudent[e.first]++;
+            perCourse[e.second]++;
+        }
+        for (uint32_t s = 0; s < perStudent.size(); ++s)
+            if (perStudent[s])
+                grow(coursesOf, s).slots.reserve(coursesOf[s].slots.size() + perStudent[s]);
+        for (uint32_t c = 0; c < perCourse.size(); ++c)
+            if (perCourse[c])
+                grow(studentsOf, c).slots.reserve(studentsOf[c].slots.size() + perCourse[c]);
+        edgeSlots.reserve(edgeSlots.size() + edges.size());
+        for (const auto &e : edges)
+            link(e.first, e.second);
+    }
+
+    // Like link(), but an existing edge is moved to the end of the course's
+    // list, so a roster read back from courses.csv keeps its on-disk order.
+    void linkInCourseOrder(uint32_t s, uint32_t c) {
+        if (link(s, c)) // materializes
+            return;
+        auto &slot = edgeSlots[edgeKey(s, c)].second;
+        if (slot + 1 == studentsOf[c].slots.size())
+            return;
+        Adjacency &adj = studentsOf.edit(c);
+        adj.slots[slot] = kVacant;
+        slot = static_cast<uint32_t>(adj.slots.size());
+        adj.slots.push_back(s);
+        compactCourse(c);
+    }
+
+    // Returns false if the edge did not exist.
+    bool unlink(uint32_t s, uint32_t c) {
+        materialize();
+        auto it = edgeSlots.find(edgeKey(s, c));
+        if (it == edgeSlots.end())
+            return false;
+        Adjacency &courseList = coursesOf.edit(s);
+        courseList.slots[it->second.first] = kVacant;
+        courseList.live--;
+        Adjacency &studentList = studentsOf.edit(c);
+        studentList.slots[it->second.second] = kVacant;
+        studentList.live--;
+        edgeSlots.erase(it);
+        compactStudent(s);
+        compactCourse(c);
+        return true;
+    }
+
+    // Drop every edge of a student; only that student's courses are touched.
+    void removeStudent(uint32_t s) {
+        materialize();
+        if (s >= coursesOf.size())
+            return;
+        for (uint32_t c : coursesOf[s].slots) {
+            if (c == kVacant) continue;
+            auto it = edgeSlots.find(edgeKey(s, c));
+            Adjacency &studentList = studentsOf.edit(c);
+            studentList.slots[it->second.second] = kVacant;
+            studentList.live--;
+            edgeSlots.erase(it);
+            compactCourse(c);
+        }
+        coursesOf.edit(s) = Adjacency();
+    }
+
+    // Drop every edge of a course; only its enrolled students are touched.
+    void removeCourse(uint32_t c) {
+        materialize();
+        if (c >= studentsOf.size())
+            return;
+        for (uint32_t s : studentsOf[c].slots) {
+            if (s == kVacant) continue;
+            auto it = edgeSlots.find(edgeKey(s, c));
+            Adjacency &courseList = coursesOf.edit(s);
+            courseList.slots[it->second.first] = kVacant;
+            courseList.live--;
+            edgeSlots.erase(it);
+            compactStudent(s);
+        }
+        studentsOf.edit(c) = Adjacency();
+    }
+
+    // Flatten one side of the graph into CSR form: offsets gets count + 1
+    // entries and the neighbours of handle h are edges[offsets[h]..offsets[h+1]).
+    void flattenCourses(size_t studentCount, vector<uint32_t> &offsets, vector<uint32_t> &edges) const {
+        if (mapped)
+            mappedCourses.flatten(studentCount, offsets, edges);
+        else
+            flatten(coursesOf, studentCount, offsets, edges);
+    }
+
+    void flattenStudents(size_t courseCount, vector<uint32_t> &offsets, vector<uint32_t> &edges) const {
+        if (mapped)
+            mappedStudents.flatten(courseCount, offsets, edges);
+        else
+            flatten(studentsOf, courseCount, offsets, edges);
+    }
+
+    // Replace the whole graph with the two CSR sides produced by flatten*.
+    // Both sides must describe the same set of edges.
+    void assign(const vector<uint32_t> &courseOffsets, const vector<uint32_t> &courseEdges,
+                const vector<uint32_t> &studentOffsets, const vector<uint32_t> &studentEdges) {
+        mapped = false;
+        coursesOf.clear();
+        coursesOf.resize(courseOffsets.size() - 1);
+        studentsOf.clear();
+        studentsOf.resize(studentOffsets.size() - 1);
+        edgeSlots.clear();
+        edgeSlots.reserve(courseEdges.size());
+        for (uint32_t s = 0; s + 1 < courseOffsets.size(); ++s) {
+            Adjacency &adj = coursesOf.edit(s);
+            adj.slots.assign(courseEdges.begin() + courseOffsets[s], courseEdges.begin() + courseOffsets[s + 1]);
+            adj.live = static_cast<uint32_t>(adj.slots.size());
+            for (uint32_t i = 0; i < adj.live; ++i)
+                edgeSlots.emplace(edgeKey(s, adj.slots[i]), make_pair(i, 0u));
+        }
+        for (uint32_t c = 0; c + 1 < studentOffsets.size(); ++c) {
+            Adjacency &adj = studentsOf.edit(c);
+            adj.slots.assign(studentEdges.begin() + studentOffsets[c], studentEdges.begin() + studentOffsets[c + 1]);
+            adj.live = static_cast<uint32_t>(adj.slots.size());
+            for (uint32_t i = 0; i < adj.live; ++i)
+                edgeSlots[edgeKey(adj.slots[i], c)].second = i;
+        }
+    }
+
+    // Read both sides in place from CSR arrays laid out as by flatten*,
+    // `students` and `courses` handles long (offsets hold count + 1
+    // uint32 entries), verified through `pages`. The bytes and pages must
+    // outlive the graph and its copies.
+    void assignMapped(const SnapshotPages &pages, string_view courseOffsets, string_view courseEdges,
+                      string_view studentOffsets, string_view studentEdges, size_t students, size_t courses) {
+        coursesOf.clear();
+        studentsOf.clear();
+        edgeSlots.clear();
+        auto side = [&pages](string_view offsets, string_view edges, size_t count, size_t limit) {
+            MappedSide m;
+            m.pages = &pages;
+            m.offsets = offsets.data();
+            m.edges = edges.data();
+            size_t entries = offsets.size() / 4;
+            m.count = min(count, entries ? entries - 1 : 0);
+            m.edgeCount = edges.size() / 4;
+            m.limit = static_cast<uint32_t>(limit);
+            return m;
+        };
+        mappedCourses = side(courseOffsets, courseEdges, students, courses);
+        mappedStudents = side(studentOffsets, studentEdges, courses, students);
+        mapped = true;
+    }
+
+    // Visit the course handles a student is enrolled in, in enrollment order.
+    template <typename Fn>
+    void forEachCourse(uint32_t s, Fn fn) const {
+        if (mapped) {
+            mappedCourses.visit(s, [&](uint32_t c) {
+                fn(c);
+                return true;
+            });
+            return;
+        }
+        if (const pmr::vector<uint32_t> *slots = slotsOf(coursesOf, s))
+            for (uint32_t c : *slots)
+                if (c != kVacant)
+                    fn(c);
+    }
+
+    // Visit the student handles enrolled in a course, in enrollment order.
+    template <typename Fn>
+    void forEachStudent(uint32_t c, Fn fn) const {
+        if (mapped) {
+            mappedStudents.visit(c, [&](uint32_t s) {
+                fn(s);
+                return true;
+            });
+            return;
+        }
+        if (const pmr::vector<uint32_t> *slots = slotsOf(studentsOf, c))
+            for (uint32_t s : *slots)
+                if (s != kVacant)
+                    fn(s);
+    }
+};
+
+// ----------------------------
+// Binary Snapshot Helpers
+// ----------------------------
+// A snapshot file is a fixed header, a payload of sections and, since
+// version 4, a checksum table:
+//   header:   magic "SMSSNAP\0", uint32 version, uint32 flags (0),
+//             uint64 payload size, uint64 checksum (of the payload before
+//             version 4, of the table since)
+//   payload:  student ID strings, course code strings,
+//             student columns (ID handle, name, type),
+//             course columns (code handle, name),
+//             enrollment as two CSR arrays (courses per student and
+//             students per course, each in enrollment order),
+//             since version 2: capacity per course row and the waitlists
+//             as a CSR array of student handles per course row,
+//             since version 3: student and course handles changed since
+//             the last export
+//   table:    checksum64 of each SnapshotPages::kChunk bytes of payload,
+//             so a lazy load can verify just the chunks it reads
+// String sections are a count, count + 1 uint64 offsets and one blob.
+// Integers are stored in host byte order; the magic/version check rejects
+// files from an incompatible build.
+const char kSnapshotMagic[8] = {'S', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t kSnapshotVersion = 4;
+const size_t kSnapshotHeaderSize = 32;
+
+// With --lazy the snapshot stays mapped and only the ID tables and row
+// columns are copied at startup; names and enrollment lists are read in
+// place, so only the pages a command touches are ever loaded.
+bool &lazySnapshot() {
+    static bool enabled = false;
+    return enabled;
+}
+
+// 64-bit checksum over a byte range, mixing eight bytes per step.
+uint64_t checksum64(string_view bytes) {
+    const uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = 0xCBF29CE484222325ULL ^ (bytes.size() * kMul);
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t w;
+        memcpy(&w, bytes.data() + i, 8);
+        h = (h ^ w) * kMul;
+        h ^= h >> 29;
+    }
+    for (; i < bytes.size(); ++i)
+        h = (h ^ static_cast<unsigned char>(bytes[i])) * kMul;
+    return h ^ (h >> 32);
+}
+
+// The checksum table for a snapshot payload: one checksum64 per chunk.
+string chunkChecksums(string_view payload) {
+    string table;
+    for (size_t offset = 0; offset < payload.size(); offset += SnapshotPages::kChunk) {
+        uint64_t sum = checksum64(payload.substr(offset, SnapshotPages::kChunk));
+        table.append(reinterpret_cast<const char *>(&sum), sizeof sum);
+    }
+    return table;
+}
+
+// Appends fixed-size values and arrays to an in-memory payload.
+class SnapshotWriter {
+private:
+    string buffer;
+public:
+    template <typename T>
+    void put(T value) {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    template <typename T>
+    void putArray(const vector<T> &values) {
+        put<uint64_t>(values.size());
+        buffer.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+    }
+    void putBytes(string_view bytes) {
+        put<uint64_t>(bytes.size());
+        buffer.append(bytes);
+    }
+    // Append what another writer has put, as if put here.
+    void append(const SnapshotWriter &other) { buffer.append(other.buffer); }
+    const string &data() const { return buffer; }
+};
+
+// Bounds-checked reader over a mapped payload. Any short read marks the
+// reader bad and returns zeros/empties, so callers check good() once.
+class SnapshotReader {
+private:
+    string_view data;
+    size_t pos = 0;
+    bool ok = true;
+
+    bool require(size_t n) {
+        if (!ok || n > data.size() - pos)
+            ok = false;
+        return ok;
+    }
+
+public:
+    explicit SnapshotReader(string_view data) : data(data) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (require(sizeof(T))) {
+            memcpy(&value, data.data() + pos, sizeof(T));
+            pos += sizeof(T);
+        }
+        return value;
+    }
+    template <typename T>
+    void getArray(vector<T> &values) {
+        uint64_t n = get<uint64_t>();
+        if (!ok || n > (data.size() - pos) / sizeof(T)) {
+            ok = false;
+            return;
+        }
+        values.resize(n);
+        memcpy(values.data(), data.data() + pos, n * sizeof(T));
+        pos += n * sizeof(T);
+    }
+    // An array's bytes in place, for arrays that are read lazily.
+    template <typename T>
+    string_view getArrayBytes() {
+        uint64_t n = get<uint64_t>();
+        if (!ok || n > (data.size() - pos) / sizeof(T)) {
+            ok = false;
+            return string_view();
+        }
+        string_view bytes = data.substr(pos, n * sizeof(T));
+        pos += n * sizeof(T);
+        return bytes;
+    }
+    string_view getBytes() {
+        uint64_t n = get<uint64_t>();
+        if (!require(n))
+            return string_view();
+        string_view bytes = data.substr(pos, n);
+        pos += n;
+        return bytes;
+    }
+    bool good() const { return ok; }
+    bool atEnd() const { return pos == data.size(); }
+};
+
+// ----------------------------
+// Class: OperationLog
+// ----------------------------
+// Append-only write-ahead log of model mutations. The file starts with a
+// header naming the snapshot it extends (by payload checksum, 0 when the
+// state came from CSV), followed by records of
+//   uint32 body length, uint32 body checksum, body
+// where the body is a one-byte LogOp and its string fields, each stored as
+// uint32 length + bytes. Records are buffered and written + fsynced by
+// commit() (group commit): the caller commits once per user command, and
+// append() writes a group out early, unsynced, when it fills up. A torn
+// tail left by a crash fails its checksum and is discarded on the next open.
+enum class LogOp : uint8_t {
+    AddStudent = 1,        // id, name, type
+    RemoveStudent,         // id
+    AddCourse,             // code, name
+    RemoveCourse,          // code
+    Enroll,                // id, code
+    RemoveFromCourse,      // id, code
+    EnrollBatch,           // id, code, id, code, ...: edges linked by one enrollBatch
+    SetCapacity,           // code, capacity (0 = unlimited)
+    Waitlist,              // id, code
+    ChangesExported        // (none): changes so far went to an export
+};
+
+const char kLogMagic[8] = {'S', 'M', 'S', 'W', 'A', 'L', '\0', '\0'};
+const uint32_t kLogVersion = 1;
+const size_t kLogHeaderSize = 24;
+
+class OperationLog {
+private:
+    static constexpr size_t kGroupRecords = 256;
+
+    // A commit is sealed with writers excluded (seal() moves the buffered
+    // records onto a queue) and flushed without them (flush() writes and
+    // fsyncs the queue under ioLock). ioLock is never held while waiting
+    // for the model, so a writer sealing a batch never waits for an fsync
+    // and two flushes still reach the file in seal order.
+    string filename;
+    string pending;              // appended records (writers)
+    size_t pendingRecords = 0;
+    size_t recordStart = 0;      // of the record being built
+    bool recording = false;
+    uint64_t sealedBytes = 0;    // file size once the queue is written (writers)
+    uint64_t sealedTotal = 0;    // record bytes ever sealed (writers)
+    mutex queueLock;
+    deque<string> queue;         // sealed batches, oldest first (queueLock)
+    mutex ioLock;
+    uint64_t writtenBytes = 0;   // bytes in the file (ioLock)
+    uint64_t syncedBytes = 0;    // of which fsynced (ioLock)
+    uint64_t writtenTotal = 0;   // record bytes ever written (ioLock)
+    uint64_t durableTotal = 0;   // of which fsynced (ioLock)
+    atomic<bool> active{false};
+    atomic<bool> failed{false};  // a write failed; off until the next open()
+    uint64_t opens = 0;          // open() calls, to tell a reopened log (writers)
+    string rebaseBuffer;
+    unique_ptr<AtomicFileWriter> rebased; // prepareRebase() output (writers)
+    uint64_t rebasedBytes = 0;
+#if SMS_POSIX
+    int fd = -1;
+#else
+    ofstream file;
+#endif
+
+    bool writeAll(const char *data, size_t size) {
+#if SMS_POSIX
+        return writeFully(fd, data, size);
+#else
+        file.write(data, size);
+        return static_cast<bool>(file);
+#endif
+    }
+
+    bool sync() {
+#if SMS_POSIX
+        return ::fsync(fd) == 0;
+#else
+        return static_cast<bool>(file.flush());
+#endif
+    }
+
+    void closeFile() {
+#if SMS_POSIX
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#else
+        if (file.is_open())
+            file.close();
+#endif
+        active = false;
+    }
+
+    // Write the queued batches, and fsync them if asked to; ioLock held.
+    // If that fails the file is cut back to its last fsynced size, so no
+    // torn record is left for later ones to be appended behind (replay
+    // would stop at it), and the log is closed: it records nothing and
+    // every flush fails until it is reopened by the next checkpoint.
+    void writeQueued(bool durable) {
+        deque<string> batches;
+        {
+            lock_guard<mutex> guard(queueLock);
+            batches.swap(queue);
+        }
+        if (!active)
+            return;
+        bool ok = true;
+        for (const string &batch : batches) {
+            if (!(ok = writeAll(batch.data(), batch.size())))
+                break;
+            writtenBytes += batch.size();
+            writtenTotal += batch.size();
+        }
+        if (ok && durable && durableTotal != writtenTotal) {
+            ok = sync();
+            if (ok) {
+                syncedBytes = writtenBytes;
+                durableTotal = writtenTotal;
+            }
+        }
+        if (ok)
+            return;
+#if SMS_POSIX
+        if (::ftruncate(fd, static_cast<off_t>(syncedBytes)) == 0)
+            ::fsync(fd);
+        closeFile();
+#else
+        closeFile();
+        error_code ec;
+        fs::resize_file(filename, syncedBytes, ec);
+#endif
+        failed = true;
+    }
+
+    static string header(uint64_t base) {
+        SnapshotWriter header;
+        for (char c : kLogMagic)
+            header.put(c);
+        header.put<uint32_t>(kLogVersion);
+        header.put<uint32_t>(0);
+        header.put<uint64_t>(base);
+        return header.data();
+    }
+
+    // The base named by a log file's header; false if data is not a log.
+    static bool readHeader(string_view data, uint64_t &base) {
+        if (data.size() < kLogHeaderSize || memcmp(data.data(), kLogMagic, 8) != 0)
+            return false;
+        SnapshotReader header(data.substr(8, kLogHeaderSize - 8));
+        uint32_t version = header.get<uint32_t>();
+        header.get<uint32_t>();
+        base = header.get<uint64_t>();
+        return version == kLogVersion;
+    }
+
+public:
+    ~OperationLog() {
+        commit();
+        closeFile();
+    }
+
+    bool isActive() const { return active; }
+    bool hasFailed() const { return failed; }
+    uint64_t size() const { return sealedBytes + pending.size(); }
+
+    // Open the log for appending, with writers excluded. When keepBytes is
+    // non-zero the first keepBytes of an existing, already replayed log
+    // are kept (which also drops a torn tail); otherwise the file is
+    // recreated with a fresh header for the given base. Whatever was
+    // logged before is taken to be in that base.
+    bool open(const string &path, uint64_t base, uint64_t keepBytes = 0) {
+        lock_guard<mutex> io(ioLock);
+        closeFile();
+        filename = path;
+        pending.clear();
+        pendingRecords = 0;
+        {
+            lock_guard<mutex> guard(queueLock);
+            queue.clear();
+        }
+        failed = false;
+        opens++;
+        writtenTotal = durableTotal = sealedTotal;
+#if SMS_POSIX
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (fd < 0)
+            return false;
+        if (::ftruncate(fd, static_cast<off_t>(keepBytes)) != 0 ||
+            ::lseek(fd, 0, SEEK_END) < 0) {
+            closeFile();
+            return false;
+        }
+#else
+        if (keepBytes == 0) {
+            file.open(path, ios::binary | ios::trunc);
+        } else {
+            error_code ec;
+            fs::resize_file(path, keepBytes, ec);
+            file.open(path, ios::binary | ios::app);
+        }
+        if (!file)
+            return false;
+#endif
+        uint64_t size = keepBytes;
+        if (keepBytes == 0) {
+            string fresh = header(base);
+            if (!writeAll(fresh.data(), fresh.size()) || !sync()) {
+                closeFile();
+                return false;
+            }
+            size = fresh.size();
+        }
+        sealedBytes = writtenBytes = syncedBytes = size;
+        active = true;
+        return true;
+    }
+
+    void append(LogOp op, initializer_list<string_view> fields) {
+        beginRecord(op);
+        for (string_view field : fields)
+            appendField(field);
+        endRecord();
+    }
+
+    // append() one field at a time, for records with too many fields to
+    // list up front: beginRecord(), appendField() per field, endRecord().
+    void beginRecord(LogOp op) {
+        recording = active;
+        if (!recording)
+            return;
+        recordStart = pending.size();
+        pending.append(8, '\0'); // length and checksum, set by endRecord()
+        pending.push_back(static_cast<char>(op));
+    }
+
+    void appendField(string_view field) {
+        if (!recording)
+            return;
+        uint32_t len = static_cast<uint32_t>(field.size());
+        pending.append(reinterpret_cast<const char *>(&len), sizeof(len));
+        pending.append(field);
+    }
+
+    void endRecord() {
+        if (!recording)
+            return;
+        recording = false;
+        string_view body(pending.data() + recordStart + 8, pending.size() - recordStart - 8);
+        uint32_t len = static_cast<uint32_t>(body.size());
+        uint32_t check = static_cast<uint32_t>(checksum64(body));
+        memcpy(&pending[recordStart], &len, sizeof(len));
+        memcpy(&pending[recordStart + 4], &check, sizeof(check));
+        // A full group is written out without an fsync, unless a flush is
+        // busy with the file; then it stays queued for that flush's caller
+        // or the next one.
+        if (++pendingRecords >= kGroupRecords) {
+            seal();
+            unique_lock<mutex> io(ioLock, try_to_lock);
+            if (io.owns_lock())
+                writeQueued(false);
+        }
+    }
+
+    // First half of a commit, with writers excluded: queue the buffered
+    // records. Returns the ticket to pass to flush().
+    uint64_t seal() {
+        if (!pending.empty()) {
+            sealedBytes += pending.size();
+            sealedTotal += pending.size();
+            lock_guard<mutex> guard(queueLock);
+            queue.push_back(move(pending));
+            pending.clear();
+        }
+        pendingRecords = 0;
+        return sealedTotal;
+    }
+
+    // Second half, while writers carry on: write and fsync everything
+    // queued. Returns true once every record sealed up to ticket is on
+    // stable storage (always, for a log that was never opened).
+    bool flush(uint64_t ticket) {
+        lock_guard<mutex> io(ioLock);
+        writeQueued(true);
+        return durableTotal >= ticket;
+    }
+
+    // Both halves at once; writers excluded throughout.
+    bool commit() { return flush(seal()); }
+
+    // Moving the log onto a snapshot of an earlier state, for a snapshot
+    // written while writers carry on. mark() notes where the records in
+    // that state end; later, prepareRebase() writes <path>.tmp with the
+    // new base and the records after the mark, and finishRebase() renames
+    // it over the log and appends to it. All three with writers excluded.
+    // prepareRebase() fails if the log was reopened or failed since the
+    // mark. A crash between the caller's snapshot rename and
+    // finishRebase() is finished by recover().
+    struct Mark {
+        uint64_t opens = 0;
+        uint64_t bytes = 0;
+    };
+
+    Mark mark() {
+        seal();
+        return {opens, sealedBytes};
+    }
+
+    bool prepareRebase(const Mark &from, uint64_t base) {
+        rebased.reset();
+        if (!commit() || !active || from.opens != opens)
+            return false;
+        lock_guard<mutex> io(ioLock);
+        MappedFile current(filename);
+        if (!current.isOpen() || current.view().size() < writtenBytes || from.bytes > writtenBytes)
+            return false;
+        rebased = make_unique<AtomicFileWriter>(rebaseBuffer);
+        if (rebased->open(filename)) {
+            rebased->write(header(base));
+            rebased->write(current.view().substr(from.bytes, writtenBytes - from.bytes));
+            rebasedBytes = kLogHeaderSize + writtenBytes - from.bytes;
+        }
+        if (!rebased->sync())
+            rebased.reset();
+        return rebased != nullptr;
+    }
+
+    bool finishRebase(uint64_t base) {
+        bool ok = rebased && rebased->replace();
+        rebased.reset();
+        string path = filename;
+        return ok && open(path, base, rebasedBytes);
+    }
+
+    // Put a <path>.tmp left by an interrupted rebase in place if it
+    // extends base, which is then the snapshot it was written for; any
+    // other leftover is stale.
+    static void recover(const string &path, uint64_t base) {
+        string temp = path + ".tmp";
+        error_code ec;
+        if (!fs::exists(temp, ec))
+            return;
+        uint64_t tempBase = 0;
+        bool current;
+        {
+            MappedFile file(temp);
+            current = file.isOpen() && readHeader(file.view(), tempBase) && tempBase == base;
+        }
+        if (current)
+            fs::rename(temp, path, ec);
+        else
+            fs::remove(temp, ec);
+    }
+
+    // Replay the log at path if it extends the given base. fn(op, fields)
+    // is called for every intact record. Returns the number of valid bytes
+    // (header plus intact records), or 0 if there is no usable log.
+    template <typename Fn>
+    static uint64_t replay(const string &path, uint64_t base, Fn fn) {
+        MappedFile file(path);
+        string_view data = file.isOpen() ? file.view() : string_view();
+        uint64_t logBase;
+        if (!readHeader(data, logBase) || logBase != base)
+            return 0;
+
+        size_t pos = kLogHeaderSize;
+        vector<string_view> fields;
+        while (data.size() - pos >= 8) {
+            uint32_t len, check;
+            memcpy(&len, data.data() + pos, 4);
+            memcpy(&check, data.data() + pos + 4, 4);
+            if (len == 0 || len > data.size() - pos - 8)
+                break;
+            string_view body = data.substr(pos + 8, len);
+            if (static_cast<uint32_t>(checksum64(body)) != check)
+                break;
+            fields.clear();
+            string_view rest = body.substr(1);
+            bool intact = true;
+            while (!rest.empty()) {
+                uint32_t fieldLen;
+                if (rest.size() < 4) { intact = false; break; }
+                memcpy(&fieldLen, rest.data(), 4);
+                rest.remove_prefix(4);
+                if (fieldLen > rest.size()) { intact = false; break; }
+                fields.push_back(rest.substr(0, fieldLen));
+                rest.remove_prefix(fieldLen);
+            }
+            if (!intact)
+                break;
+            fn(static_cast<LogOp>(body[0]), fields);
+            pos += 8 + len;
+        }
+        return pos;
+    }
+};
+
+// ----------------------------
+// Class: ReportCache
+// ----------------------------
+// Materialized report bodies keyed by course or student handle. The owner
+// patches an entry when a line is appended and invalidates it on anything
+// else; an invalid entry is rebuilt on the next report. `live` counts valid
+// entries so invalidation is skipped outright while nothing is cached.
+class ReportCache {
+private:
+    vector<string> bodies;
+    vector<uint8_t> valid;
+    size_t live = 0;
+
+public:
+    bool empty() const { return live == 0; }
+
+    // Cached body for handle h, or nullptr if it must be rebuilt.
+    string *find(uint32_t h) {
+        return h < valid.size() && valid[h] ? &bodies[h] : nullptr;
+    }
+
+    const string *find(uint32_t h) const {
+        return h < valid.size() && valid[h] ? &bodies[h] : nullptr;
+    }
+
+    // Start a fresh body for h and mark it valid; the caller fills it in.
+    string &rebuild(uint32_t h) {
+        if (h >= valid.size()) {
+            valid.resize(h + 1, 0);
+            bodies.resize(h + 1);
+        }
+        if (!valid[h]) {
+            valid[h] = 1;
+            live++;
+        }
+        bodies[h].clear();
+        return bodies[h];
+    }
+
+    void invalidate(uint32_t h) {
+        if (h < valid.size() && valid[h]) {
+            valid[h] = 0;
+            live--;
+            string().swap(bodies[h]);
+        }
+    }
+
+    void clear() {
+        bodies.clear();
+        valid.clear();
+        live = 0;
+    }
+};
+
+// ----------------------------
+// Class: DirtySet
+// ----------------------------
+// Handles marked since the last take(), each listed once, in the order
+// they were first marked. Marking is a bit test, so the mutations can
+// afford it on every call.
+class DirtySet {
+private:
+    vector<bool> marked;
+    vector<uint32_t> handles;
+
+public:
+    bool empty() const { return handles.empty(); }
+    size_t size() const { return handles.size(); }
+
+    void mark(uint32_t h) {
+        if (h >= marked.size())
+            marked.resize(h + 1, false);
+        if (!marked[h]) {
+            marked[h] = true;
+            handles.push_back(h);
+        }
+    }
+
+    const vector<uint32_t> &list() const { return handles; }
+
+    // Return the marked handles and unmark them all.
+    vector<uint32_t> take() {
+        for (uint32_t h : handles)
+            marked[h] = false;
+        vector<uint32_t> taken;
+        taken.swap(handles);
+        return taken;
+    }
+};
+
+// The students and courses a delta export writes, by handle.
+struct ChangeMarks {
+    vector<uint32_t> students;
+    vector<uint32_t> courses;
+
+    bool empty() const { return students.empty() && courses.empty(); }
+};
+
+// ----------------------------
+// Class: SortedColumn
+// ----------------------------
+// Handles kept sorted by a caller-supplied order, for paged listings.
+// Nothing is built until the first read. After that, new handles are
+// appended unsorted and merged in on the next read (one sort of the
+// newcomers plus one linear merge, however many arrived), and removals are
+// found by binary search. The order must not change while a handle is in
+// the column, and remove() must run while the handle's sort key is still
+// readable.
+class SortedColumn {
+private:
+    vector<uint32_t> order;
+    size_t sorted = 0; // order[0, sorted) is in order, the rest is new
+    bool built = false;
+
+public:
+    bool isBuilt() const { return built; }
+
+    // Start from handles already in order.
+    void assign(vector<uint32_t> handles) {
+        order = move(handles);
+        sorted = order.size();
+        built = true;
+    }
+
+    void add(uint32_t h) {
+        if (built)
+            order.push_back(h);
+    }
+
+    template <typename Less>
+    void remove(uint32_t h, Less less) {
+        if (!built)
+            return;
+        auto end = order.begin() + sorted;
+        auto it = lower_bound(order.begin(), end, h, less);
+        if (it != end && *it == h) {
+            order.erase(it);
+            sorted--;
+        } else {
+            it = find(end, order.end(), h);
+            if (it != order.end())
+                order.erase(it);
+        }
+    }
+
+    // The handles in order; merges pending additions first.
+    template <typename Less>
+    const vector<uint32_t> &view(Less less) {
+        if (sorted < order.size()) {
+            sort(order.begin() + sorted, order.end(), less);
+            inplace_merge(order.begin(), order.begin() + sorted, order.end(), less);
+            sorted = order.size();
+        }
+        return order;
+    }
+
+    void clear() {
+        order.clear();
+        sorted = 0;
+        built = false;
+    }
+};
+
+// How a paged listing is sorted. Courses use Id for the course code and
+// have no Type order. Ties are broken by ID, so every order is total.
+enum class ListOrder : uint8_t { Id, Name, Type };
+
+// Parse "id" ("code" for courses), "name" or "type".
+bool parseListOrder(string_view text, bool courses, ListOrder &order) {
+    if (text == (courses ? "code" : "id"))
+        order = ListOrder::Id;
+    else if (text == "name")
+        order = ListOrder::Name;
+    else if (text == "type" && !courses)
+        order = ListOrder::Type;
+    else
+        return false;
+    return true;
+}
+
+// Listing cursors are the sort key of the last row shown, so a page can
+// resume after it even if that row has since been removed. Callers should
+// treat them as opaque: the fields are joined by a separator and hex-encoded.
+string encodeCursor(initializer_list<string_view> fields) {
+    static const char digits[] = "0123456789abcdef";
+    string raw, out;
+    for (string_view field : fields)
+        raw.append(field).push_back('\x1f');
+    for (unsigned char c : raw) {
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 15]);
+    }
+    return out;
+}
+
+// Decode into raw and split it into fields (views into raw). Returns
+// false for text that encodeCursor cannot have produced.
+bool decodeCursor(string_view cursor, string &raw, vector<string_view> &fields) {
+    auto nibble = [](char c) {
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    };
+    if (cursor.size() % 2)
+        return false;
+    raw.clear();
+    for (size_t i = 0; i < cursor.size(); i += 2) {
+        int hi = nibble(cursor[i]), lo = nibble(cursor[i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        raw.push_back(char(hi << 4 | lo));
+    }
+    if (raw.empty() || raw.back() != '\x1f')
+        return false;
+    fields.clear();
+    string_view rest(raw.data(), raw.size() - 1);
+    while (true) {
+        size_t end = rest.find('\x1f');
+        fields.push_back(rest.substr(0, end));
+        if (end == string_view::npos)
+            break;
+        rest.remove_prefix(end + 1);
+    }
+    return true;
+}
+
+// ----------------------------
+// Class: TrigramIndex
+// ----------------------------
+// Inverted index from each 3-byte substring to the sorted handles whose text
+// contains it. A keyword of three or more bytes can only occur in texts that
+// contain all of its trigrams, so intersecting those posting lists gives a
+// small candidate set; callers still verify each candidate with a real
+// substring check.
+class TrigramIndex {
+private:
+    unordered_map<uint32_t, vector<uint32_t>> postings;
+    vector<uint32_t> scratch;  // reused by add/remove
+
+    static void trigramsOf(string_view text, vector<uint32_t> &grams) {
+        grams.clear();
+        for (size_t i = 0; i + kGram <= text.size(); ++i)
+            grams.push_back((static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16) |
+                            (static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8) |
+                            static_cast<unsigned char>(text[i + 2]));
+        sort(grams.begin(), grams.end());
+        grams.erase(unique(grams.begin(), grams.end()), grams.end());
+    }
+
+public:
+    static constexpr size_t kGram = 3;
+
+    void add(uint32_t handle, string_view text) {
+        trigramsOf(text, scratch);
+        for (uint32_t g : scratch) {
+            vector<uint32_t> &list = postings[g];
+            if (list.empty() || list.back() < handle) {
+                list.push_back(handle);
+                continue;
+            }
+            auto it = lower_bound(list.begin(), list.end(), handle);
+            if (*it != handle)
+                list.insert(it, handle);
+        }
+    }
+
+    void remove(uint32_t handle, string_view text) {
+        trigramsOf(text, scratch);
+        for (uint32_t g : scratch) {
+            auto p = postings.find(g);
+            if (p == postings.end())
+                continue;
+            vector<uint32_t> &list = p->second;
+            auto it = lower_bound(list.begin(), list.end(), handle);
+            if (it != list.end() && *it == handle)
+                list.erase(it);
+            if (list.empty())
+                postings.erase(p);
+        }
+    }
+
+    // Handles whose text contains every trigram of keyword (keyword must be
+    // at least kGram bytes), smallest posting list first.
+    void candidates(string_view keyword, vector<uint32_t> &out) const {
+        out.clear();
+        vector<uint32_t> grams;
+        trigramsOf(keyword, grams);
+        vector<const vector<uint32_t> *> lists;
+        for (uint32_t g : grams) {
+            auto p = postings.find(g);
+            if (p == postings.end())
+                return;
+            lists.push_back(&p->second);
+        }
+        if (lists.empty())
+            return;
+        sort(lists.begin(), lists.end(),
+             [](const vector<uint32_t> *a, const vector<uint32_t> *b) { return a->size() < b->size(); });
+        out = *lists[0];
+        vector<uint32_t> next;
+        for (size_t i = 1; i < lists.size() && !out.empty(); ++i) {
+            next.clear();
+            set_intersection(out.begin(), out.end(), lists[i]->begin(), lists[i]->end(), back_inserter(next));
+            out.swap(next);
+        }
+    }
+};
+
+// ----------------------------
+// Status Codes and Message Sink
+// ----------------------------
+// Outcome of a model mutation. Callers that need to react check the
+// returned Status; the human-readable message goes to the MessageSink.
+enum class Status : uint8_t {
+    Ok,
+    StudentExists,
+    UnknownStudentType,
+    StudentNotFound,
+    CourseExists,
+    CourseNotFound,
+    AlreadyEnrolled,
+    NotEnrolled,
+    InvalidArgument,
+    Waitlisted,
+    IoError
+};
+
+const char *statusName(Status status) {
+    switch (status) {
+        case Status::Ok:                 return "ok";
+        case Status::StudentExists:      return "student already exists";
+        case Status::UnknownStudentType: return "unknown student type";
+        case Status::StudentNotFound:    return "student not found";
+        case Status::CourseExists:       return "course already exists";
+        case Status::CourseNotFound:     return "course not found";
+        case Status::AlreadyEnrolled:    return "already enrolled";
+        case Status::NotEnrolled:        return "not enrolled";
+        case Status::InvalidArgument:    return "invalid argument";
+        case Status::Waitlisted:         return "course full; added to the waitlist";
+        case Status::IoError:            return "I/O error";
+    }
+    return "unknown status";
+}
+
+// Where status messages go: dropped, collected for the caller to take(),
+// or printed straight to cout. Parts are only formatted when the mode is
+// not None, so a silent caller pays one branch per message.
+enum class MessageMode { None, Buffered, Console };
+
+class MessageSink {
+private:
+    MessageMode mode;
+    ostringstream buffer;
+
+public:
+    explicit MessageSink(MessageMode mode = MessageMode::Console) : mode(mode) {}
+
+    MessageMode getMode() const { return mode; }
+    void setMode(MessageMode newMode) { mode = newMode; }
+
+    template <typename... Parts>
+    void write(const Parts &...parts) {
+        if (mode == MessageMode::None)
+            return;
+        ostream &out = mode == MessageMode::Console ? cout : buffer;
+        (out << ... << parts);
+    }
+
+    // Return and clear everything collected in Buffered mode.
+    string take() {
+        string text = buffer.str();
+        buffer.str(string());
+        return text;
+    }
+};
+
+// Switches a sink to another mode for its lifetime.
+class MessageScope {
+private:
+    MessageSink &sink;
+    MessageMode saved;
+public:
+    MessageScope(MessageSink &sink, MessageMode mode) : sink(sink), saved(sink.getMode()) {
+        sink.setMode(mode);
+    }
+    ~MessageScope() { sink.setMode(saved); }
+};
+
+// Batch enrollment results. Rejected rows are reported by row number and
+// reason instead of a console line each.
+enum class EnrollError : uint8_t {
+    MissingField,     // student ID or course code is empty
+    UnknownStudent,
+    UnknownCourse,
+    AlreadyEnrolled,
+    DuplicateRow,     // same pair appears earlier in the batch
+    CourseFull        // no free seat; the student joined the waitlist
+};
+
+const char *enrollErrorName(EnrollError error) {
+    switch (error) {
+        case EnrollError::MissingField:    return "missing student ID or course code";
+        case EnrollError::UnknownStudent:  return "student not found";
+        case EnrollError::UnknownCourse:   return "course not found";
+        case EnrollError::AlreadyEnrolled: return "already enrolled";
+        case EnrollError::DuplicateRow:    return "duplicate of an earlier row";
+        case EnrollError::CourseFull:      return "course full; added to the waitlist";
+    }
+    return "unknown error";
+}
+
+struct EnrollRowError {
+    uint32_t row;
+    EnrollError reason;
+};
+
+struct EnrollBatchReport {
+    size_t rows = 0;
+    size_t enrolled = 0;
+    vector<EnrollRowError> errors; // ascending by row
+};
+
+// A seat reserved by StudentManagement::claimSeat() ahead of the enroll
+// that uses it. Claims carry the course's generation, so one taken before
+// the course was removed is ignored by the enroll.
+struct SeatClaim {
+    uint32_t code = UINT32_MAX; // course code handle
+    uint32_t generation = 0;
+    uint64_t ticket = 0;        // arrival order, kept by the waitlist
+    bool held = false;          // a seat is reserved for this claim
+};
+
+// Shape of a generated load-test dataset; see
+// StudentManagement::generateDummyData.
+struct DummyDataSpec {
+    size_t students = 1000;
+    size_t courses = 50;
+    double enrollmentsPerStudent = 4; // mean; the fraction is a per-student coin flip
+    uint64_t seed = 1;
+};
+
+// SplitMix64: tiny, fast, and the same sequence on every platform, which
+// the standard distributions do not promise.
+struct SplitMix64 {
+    uint64_t state;
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    // Uniform in [0, n), n > 0; the modulo bias is negligible for the
+    // small ranges used here.
+    size_t below(size_t n) { return size_t(next() % n); }
+    double unit() { return double(next() >> 11) * 0x1.0p-53; }
+};
+
+// How StudentManagement::loadData reads the CSV files.
+enum class LoadMode {
+    Fast,    // whole file mapped, fields tokenized as string_views in place
+    Parallel // both files mapped at once, parsed in line-aligned chunks on a thread pool
+};
+
+// Aggregates over every enrollment, as computed by
+// ModelData::computeAnalytics. Courses are referred to by row.
+struct EnrollmentAnalytics {
+    struct CoursePair {
+        uint32_t first, second; // course rows, first listed first
+        uint32_t students;      // enrolled in both
+    };
+
+    size_t students = 0;
+    size_t enrollments = 0;
+    size_t studentsByType[2] = {0, 0};    // by StudentType
+    size_t enrollmentsByType[2] = {0, 0};
+    vector<uint32_t> perCourse;           // students enrolled, by course row
+    vector<size_t> coursesPerStudent;     // [k] = students enrolled in k courses
+    vector<uint32_t> topCourses;          // course rows, most enrolled first
+    vector<CoursePair> topPairs;          // most shared first
+};
+
+// ----------------------------
+// Class: ModelData
+// ----------------------------
+// The students, courses and enrollments themselves, plus the read-only
+// formatting built on them. StudentManagement derives from it and adds the
+// lookups, caches and logging around it.
+//
+// Copying a ModelData pins a version. Every part is copy-on-write by
+// chunk (the student and course columns, the slot indexes, the interned
+// text and the EnrollmentGraph lists), so a copy costs one pointer per
+// chunk and afterwards a write duplicates only the chunks it touches. The
+// lookup maps are not copied: a pinned version reads by handle and row
+// only. It can be exported or reported from on another thread while the
+// original keeps changing; it must not outlive the original.
+class ModelData {
+protected:
+    static constexpr uint32_t kNoSlot = numeric_limits<uint32_t>::max();
+
+    using SlotIndex = CowVector<uint32_t, 12>;
+
+    StudentTable students;
+    CowVector<Course, 8> courses;
+    EnrollmentGraph enrollment;
+
+    // Student IDs and course codes are interned once; everything else
+    // refers to them by handle.
+    InternTable studentIDs{packStudentID};
+    InternTable courseCodes;
+
+    // Handle -> slot indexes, kept in step with the vectors above
+    SlotIndex studentIndex;
+    SlotIndex courseIndex;
+
+    // The snapshot a lazy load reads names and enrollments from in place;
+    // pinned copies share it, so it stays mapped while any of them lives.
+    shared_ptr<const SnapshotPages> snapshotPages;
+
+    static int slotOf(const SlotIndex &index, uint32_t handle) {
+        if (handle >= index.size() || index[handle] == kNoSlot)
+            return -1;
+        return static_cast<int>(index[handle]);
+    }
+
+    // Utility: Find student index by studentID
+    int findStudentIndex(string_view studentID) const {
+        return slotOf(studentIndex, studentIDs.find(studentID));
+    }
+
+    // Utility: Find course index by courseCode
+    int findCourseIndex(string_view courseCode) const {
+        return slotOf(courseIndex, courseCodes.find(courseCode));
+    }
+
+    // Report row formatters shared by the reports and the cache patches.
+    void appendRosterLine(string &out, uint32_t id) const {
+        int sIdx = slotOf(studentIndex, id);
+        if (sIdx == -1)
+            return;
+        out.append(studentIDs.str(id)).push_back(',');
+        out.append(students.name(sIdx)).push_back(',');
+        out.append(studentTypeName(students.type(sIdx))).push_back('\n');
+    }
+
+    void appendCourseLine(string &out, uint32_t code) const {
+        int cIdx = slotOf(courseIndex, code);
+        if (cIdx == -1)
+            return;
+        out.append(courseCodes.str(code)).push_back(',');
+        out.append(courses[cIdx].getCourseName()).push_back('\n');
+    }
+
+    // Full report file bodies, as written by generateReportFor*. Rows
+    // cached in `cache` are used where valid but never filled in, so these
+    // are safe to call from concurrent readers.
+    void appendCourseReport(string &out, size_t cIdx, const ReportCache *cache = nullptr) const {
+        uint32_t code = courses[cIdx].getCourseCode();
+        out.append("StudentID,Name,Type\n");
+        if (const string *rows = cache ? cache->find(code) : nullptr)
+            out.append(*rows);
+        else
+            enrollment.forEachStudent(code, [&](uint32_t id) { appendRosterLine(out, id); });
+    }
+
+    void appendStudentReport(string &out, size_t row, const ReportCache *cache = nullptr) const {
+        uint32_t id = students.id(row);
+        out.append("StudentID,Name,Type\n");
+        out.append(studentIDs.str(id)).push_back(',');
+        out.append(students.name(row)).push_back(',');
+        out.append(studentTypeName(students.type(row))).append("\n\n");
+        out.append("CourseCode,CourseName\n");
+        if (const string *rows = cache ? cache->find(id) : nullptr)
+            out.append(*rows);
+        else
+            enrollment.forEachCourse(id, [&](uint32_t code) { appendCourseLine(out, code); });
+    }
+
+    // Export row formatters: one CSV line per row appended to out, with
+    // enrolled courses/students joined by ';'.
+    void appendStudentRow(string &out, size_t row) const {
+        uint32_t id = students.id(row);
+        out.append(studentIDs.str(id)).push_back(',');
+        out.append(students.name(row)).push_back(',');
+        out.append(studentTypeName(students.type(row))).push_back(',');
+        bool first = true;
+        enrollment.forEachCourse(id, [&](uint32_t code) {
+            if (!first)
+                out.push_back(';');
+            out.append(courseCodes.str(code));
+            first = false;
+        });
+        out.push_back('\n');
+    }
+
+    void appendCourseRow(string &out, size_t row) const {
+        uint32_t code = courses[row].getCourseCode();
+        out.append(courseCodes.str(code)).push_back(',');
+        out.append(courses[row].getCourseName()).push_back(',');
+        bool first = true;
+        enrollment.forEachStudent(code, [&](uint32_t id) {
+            if (!first)
+                out.push_back(';');
+            out.append(studentIDs.str(id));
+            first = false;
+        });
+        out.push_back('\n');
+    }
+
+    // Ensure directory exists
+    static void ensureDirectory(const string &dirName) {
+        if (!fs::exists(dirName))
+            fs::create_directories(dirName);
+    }
+
+public:
+    // Write Students/students.csv and Courses/courses.csv. Each table is
+    // cut into row ranges that pool workers format into separate buffers;
+    // once every buffer's size is known, the buffers are written
+    // concurrently with pwrite at their prefix-sum offsets. With
+    // compressExports(), each worker compresses its buffer into a frame of
+    // its own and the frames are written back to back the same way.
+    // Returns IoError if either file could not be written.
+    Status exportCSV(MessageSink &messages, size_t threads = ThreadPool::defaultThreads()) const {
+        OpTimer timer(Op::ExportParallel);
+        const size_t kMinRowsPerPart = 16384;
+        struct ExportPlan {
+            string dir;
+            string filename;
+            string header;
+            size_t rows;
+            bool studentRows;
+            const char *label;
+            vector<string> parts;
+        };
+        ExportPlan plans[2] = {
+            {"Students", "Students/students.csv", "StudentID,Name,Type,EnrolledCourses\n",
+             students.size(), true, "students", {}},
+            {"Courses", "Courses/courses.csv", "CourseCode,CourseName,EnrolledStudents\n",
+             courses.size(), false, "courses", {}}
+        };
+
+        const bool compress = compressExports();
+        ThreadPool pool(threads);
+        for (ExportPlan &plan : plans) {
+            ensureDirectory(plan.dir);
+            if (compress) {
+                string frame;
+                lz4AppendFrame(frame, plan.header);
+                plan.header.swap(frame);
+            }
+            size_t parts = min(max<size_t>(1, plan.rows / kMinRowsPerPart), pool.size() * 4);
+            plan.parts.resize(parts);
+            for (size_t i = 0; i < parts; ++i) {
+                size_t begin = plan.rows * i / parts, end = plan.rows * (i + 1) / parts;
+                pool.submit([this, &plan, i, begin, end, compress] {
+                    string &out = plan.parts[i];
+                    for (size_t row = begin; row < end; ++row) {
+                        if (plan.studentRows)
+                            appendStudentRow(out, row);
+                        else
+                            appendCourseRow(out, row);
+                    }
+                    if (compress) {
+                        string frame;
+                        lz4AppendFrame(frame, out);
+                        out.swap(frame);
+                    }
+                });
+            }
+        }
+        pool.wait();
+        if (withholdDamaged(messages, "Students and courses"))
+            return Status::IoError;
+
+        string unused[2];
+        unique_ptr<AtomicFileWriter> files[2];
+        atomic<bool> failed[2] = {{false}, {false}};
+        for (int f = 0; f < 2; ++f) {
+            ExportPlan &plan = plans[f];
+            files[f] = make_unique<AtomicFileWriter>(unused[f]);
+            if (!files[f]->open(exportName(plan.filename))) {
+                files[f].reset();
+                continue;
+            }
+            AtomicFileWriter *file = files[f].get();
+            atomic<bool> *fail = &failed[f];
+            uint64_t offset = plan.header.size();
+            pool.submit([file, fail, &plan] {
+                if (!file->writeAt(0, plan.header))
+                    *fail = true;
+            });
+            for (const string &part : plan.parts) {
+                pool.submit([file, fail, &part, offset] {
+                    if (!file->writeAt(offset, part))
+                        *fail = true;
+                });
+                offset += part.size();
+            }
+        }
+        pool.wait();
+
+        Status status = Status::Ok;
+        for (int f = 0; f < 2; ++f) {
+            ExportPlan &plan = plans[f];
+            if (!files[f]) {
+                messages.write("Error opening file for exporting ", plan.label, ".\n");
+                status = Status::IoError;
+                continue;
+            }
+            if (failed[f])
+                files[f]->fail();
+            if (!files[f]->commit()) {
+                messages.write("Error writing file for exporting ", plan.label, ".\n");
+                status = Status::IoError;
+                continue;
+            }
+            removeOtherForm(plan.filename);
+            messages.write(plan.studentRows ? "Students" : "Courses", " exported to ", exportName(plan.filename), "\n");
+        }
+        return status;
+    }
+
+    // Write every file under Reports/CourseReports and Reports/StudentReports.
+    // Items are split into ranges that pool workers format into one reused
+    // buffer each (rows from the optional caches are used where valid) and
+    // write with a single ofstream at a time, so at most one file per worker
+    // is open. Files are byte-identical to the per-item reports.
+    Status writeAllReports(MessageSink &messages, size_t threads = ThreadPool::defaultThreads(),
+                           const ReportCache *courseCache = nullptr,
+                           const ReportCache *studentCache = nullptr) const {
+        OpTimer timer(Op::ReportAll);
+        const size_t kMaxOpenFiles = 32;
+        const string courseDir = "Reports/CourseReports", studentDir = "Reports/StudentReports";
+        ensureDirectory(courseDir);
+        ensureDirectory(studentDir);
+
+        size_t total = courses.size() + students.size();
+        atomic<size_t> failures{0};
+        auto writeReport = [&](const string &filename, const string &body) {
+            if (!writeExportFile(filename, {body}))
+                failures++;
+        };
+        // Item i < courses.size() is a course row, the rest are student rows.
+        auto writeRange = [&](size_t begin, size_t end) {
+            string body, filename;
+            for (size_t i = begin; i < end; ++i) {
+                body.clear();
+                if (i < courses.size()) {
+                    appendCourseReport(body, i, courseCache);
+                    filename.assign(courseDir).append("/").append(courseCodes.str(courses[i].getCourseCode()));
+                } else {
+                    size_t row = i - courses.size();
+                    appendStudentReport(body, row, studentCache);
+                    filename.assign(studentDir).append("/").append(studentIDs.str(students.id(row)));
+                }
+                writeReport(filename.append(".csv"), body);
+            }
+        };
+
+        ThreadPool pool(max<size_t>(1, min(threads, kMaxOpenFiles)));
+        size_t parts = min(total, pool.size() * 4);
+        for (size_t i = 0; i < parts; ++i)
+            pool.submit([&writeRange, total, parts, i] { writeRange(total * i / parts, total * (i + 1) / parts); });
+        pool.wait();
+
+        if (failures) {
+            messages.write("Error writing ", failures.load(), " of ", total, " report files.\n");
+            return Status::IoError;
+        }
+        messages.write("Generated ", courses.size(), " course reports and ", students.size(),
+                       " student reports in Reports/\n");
+        return Status::Ok;
+    }
+
+    // True if this model was lazily loaded from a snapshot that turned out
+    // to be damaged where it was read, so some names or lists are missing;
+    // it must not be written out as a snapshot or as the CSV files.
+    bool snapshotDamaged() const { return snapshotPages && snapshotPages->damaged(); }
+
+    // Call after formatting `what` and before committing it: true (with a
+    // message) if snapshotDamaged(), and the file must be dropped.
+    bool withholdDamaged(MessageSink &messages, const char *what) const {
+        if (!snapshotDamaged())
+            return false;
+        messages.write(what, " not written: the snapshot this data was loaded from is damaged.\n");
+        return true;
+    }
+
+    // Append the snapshot payload: both ID tables, the student and course
+    // rows and both sides of the enrollment graph, in the order
+    // StudentManagement::loadSnapshot() reads them.
+    void putSnapshot(SnapshotWriter &out) const {
+        auto putStrings = [&](const InternTable &table) {
+            vector<uint64_t> offsets(1, 0);
+            string blob;
+            for (uint32_t h = 0; h < table.size(); ++h) {
+                blob.append(table.str(h));
+                offsets.push_back(blob.size());
+            }
+            out.putArray(offsets);
+            out.putBytes(blob);
+        };
+        putStrings(studentIDs);
+        putStrings(courseCodes);
+
+        vector<uint32_t> ids, handles, edges;
+        vector<uint64_t> nameOffsets(1, 0);
+        vector<uint8_t> types;
+        string names;
+        for (size_t row = 0; row < students.size(); ++row) {
+            ids.push_back(students.id(row));
+            names.append(students.name(row));
+            nameOffsets.push_back(names.size());
+            types.push_back(static_cast<uint8_t>(students.type(row)));
+        }
+        out.putArray(ids);
+        out.putArray(nameOffsets);
+        out.putBytes(names);
+        out.putArray(types);
+
+        ids.clear();
+        nameOffsets.assign(1, 0);
+        names.clear();
+        for (size_t row = 0; row < courses.size(); ++row) {
+            const Course &course = courses[row];
+            ids.push_back(course.getCourseCode());
+            names.append(course.getCourseName());
+            nameOffsets.push_back(names.size());
+        }
+        out.putArray(ids);
+        out.putArray(nameOffsets);
+        out.putBytes(names);
+
+        enrollment.flattenCourses(studentIDs.size(), handles, edges);
+        out.putArray(handles);
+        out.putArray(edges);
+        enrollment.flattenStudents(courseCodes.size(), handles, edges);
+        out.putArray(handles);
+        out.putArray(edges);
+    }
+
+    // Every aggregate in EnrollmentAnalytics from one pass over the student
+    // rows. Each pool worker takes a contiguous range of rows and walks
+    // their course lists once, filling its own per-course counts, histogram,
+    // type split and co-enrollment pair counts; the partials are summed at
+    // the end, so workers share nothing while counting. Counts are kept by
+    // course row; an edge to a code with no course row is skipped. Pair
+    // counts are a dense triangular array per worker while all of them
+    // together fit in kMaxDensePairs counters, and a hash map beyond that.
+    // Students with more than kMaxPairCourses courses are left out of the
+    // pair counts only.
+    EnrollmentAnalytics computeAnalytics(size_t topN, size_t threads = ThreadPool::defaultThreads()) const {
+        OpTimer timer(Op::Analytics);
+        const size_t kMinRowsPerPart = 16384, kMaxPairCourses = 64, kMaxDensePairs = size_t(1) << 22;
+        struct Partial {
+            vector<uint32_t> perCourse;
+            vector<size_t> histogram;
+            size_t studentsByType[2] = {0, 0};
+            size_t enrollmentsByType[2] = {0, 0};
+            vector<uint32_t> densePairs;
+            unordered_map<uint64_t, uint32_t> pairs; // course row << 32 | course row
+        };
+
+        ThreadPool pool(threads);
+        const size_t rows = students.size(), courseRows = courses.size();
+        vector<uint32_t> rowOfCode(courseCodes.size(), kNoSlot);
+        for (size_t row = 0; row < courseRows; ++row)
+            rowOfCode[courses[row].getCourseCode()] = static_cast<uint32_t>(row);
+        size_t parts = max<size_t>(1, min(rows / kMinRowsPerPart, pool.size()));
+        const size_t pairSlots = courseRows * (courseRows > 0 ? courseRows - 1 : 0) / 2;
+        const bool dense = pairSlots * parts <= kMaxDensePairs;
+        // Position of course rows a < b in the triangular pair array.
+        auto pairIndex = [courseRows](size_t a, size_t b) {
+            return a * courseRows - a * (a + 1) / 2 + (b - a - 1);
+        };
+        vector<Partial> partials(parts);
+        for (size_t i = 0; i < parts; ++i) {
+            pool.submit([this, &partials, &pairIndex, &rowOfCode, i, parts, rows, courseRows, pairSlots, dense] {
+                Partial &p = partials[i];
+                p.perCourse.assign(courseRows, 0);
+                if (dense)
+                    p.densePairs.assign(pairSlots, 0);
+                vector<uint32_t> taken;
+                for (size_t row = rows * i / parts, end = rows * (i + 1) / parts; row < end; ++row) {
+                    taken.clear();
+                    enrollment.forEachCourse(students.id(row), [&](uint32_t code) {
+                        if (code < rowOfCode.size() && rowOfCode[code] != kNoSlot)
+                            taken.push_back(rowOfCode[code]);
+                    });
+                    size_t type = static_cast<size_t>(students.type(row));
+                    p.studentsByType[type]++;
+                    p.enrollmentsByType[type] += taken.size();
+                    if (p.histogram.size() <= taken.size())
+                        p.histogram.resize(taken.size() + 1, 0);
+                    p.histogram[taken.size()]++;
+                    for (uint32_t course : taken)
+                        p.perCourse[course]++;
+                    if (taken.size() < 2 || taken.size() > kMaxPairCourses)
+                        continue;
+                    sort(taken.begin(), taken.end());
+                    for (size_t a = 0; a + 1 < taken.size(); ++a) {
+                        for (size_t b = a + 1; b < taken.size(); ++b) {
+                            if (dense)
+                                p.densePairs[pairIndex(taken[a], taken[b])]++;
+                            else
+                                p.pairs[(static_cast<uint64_t>(taken[a]) << 32) | taken[b]]++;
+                        }
+                    }
+                }
+            });
+        }
+        pool.wait();
+
+        EnrollmentAnalytics result;
+        result.perCourse.assign(courseRows, 0);
+        vector<uint32_t> densePairs = move(partials[0].densePairs);
+        unordered_map<uint64_t, uint32_t> pairs = move(partials[0].pairs);
+        for (const Partial &p : partials) {
+            for (size_t course = 0; course < courseRows; ++course)
+                result.perCourse[course] += p.perCourse[course];
+            if (result.coursesPerStudent.size() < p.histogram.size())
+                result.coursesPerStudent.resize(p.histogram.size(), 0);
+            for (size_t k = 0; k < p.histogram.size(); ++k)
+                result.coursesPerStudent[k] += p.histogram[k];
+            for (size_t t = 0; t < 2; ++t) {
+                result.studentsByType[t] += p.studentsByType[t];
+                result.enrollmentsByType[t] += p.enrollmentsByType[t];
+            }
+            if (&p == &partials[0])
+                continue;
+            for (size_t k = 0; k < p.densePairs.size(); ++k)
+                densePairs[k] += p.densePairs[k];
+            for (const auto &entry : p.pairs)
+                pairs[entry.first] += entry.second;
+        }
+        result.students = rows;
+        result.enrollments = result.enrollmentsByType[0] + result.enrollmentsByType[1];
+
+        // Ties go to the smaller course code, so the ranking is stable.
+        auto codeOf = [this](uint32_t row) { return courseCodes.str(courses[row].getCourseCode()); };
+        result.topCourses.resize(courses.size());
+        iota(result.topCourses.begin(), result.topCourses.end(), 0u);
+        size_t top = min(topN, result.topCourses.size());
+        partial_sort(result.topCourses.begin(), result.topCourses.begin() + top, result.topCourses.end(),
+                     [&](uint32_t a, uint32_t b) {
+                         if (result.perCourse[a] != result.perCourse[b])
+                             return result.perCourse[a] > result.perCourse[b];
+                         return codeOf(a) < codeOf(b);
+                     });
+        result.topCourses.resize(top);
+
+        auto addPair = [&](uint32_t a, uint32_t b, uint32_t count) {
+            if (codeOf(b) < codeOf(a))
+                swap(a, b);
+            result.topPairs.push_back({a, b, count});
+        };
+        for (size_t a = 0, k = 0; a < courseRows && !densePairs.empty(); ++a)
+            for (size_t b = a + 1; b < courseRows; ++b, ++k)
+                if (densePairs[k])
+                    addPair(uint32_t(a), uint32_t(b), densePairs[k]);
+        for (const auto &entry : pairs)
+            addPair(static_cast<uint32_t>(entry.first >> 32), static_cast<uint32_t>(entry.first), entry.second);
+        top = min(topN, result.topPairs.size());
+        partial_sort(result.topPairs.begin(), result.topPairs.begin() + top, result.topPairs.end(),
+                     [&](const EnrollmentAnalytics::CoursePair &x, const EnrollmentAnalytics::CoursePair &y) {
+                         if (x.students != y.students)
+                             return x.students > y.students;
+                         if (x.first != y.first)
+                             return codeOf(x.first) < codeOf(y.first);
+                         return codeOf(x.second) < codeOf(y.second);
+                     });
+        result.topPairs.resize(top);
+        return result;
+    }
+
+    // The analytics summary as printed by the analytics command.
+    void appendAnalytics(string &out, const EnrollmentAnalytics &stats) const {
+        auto line = [&](auto... parts) {
+            ostringstream text;
+            (text << ... << parts);
+            out.append(text.str()).push_back('\n');
+        };
+        auto course = [&](uint32_t row) {
+            return string(courseCodes.str(courses[row].getCourseCode())) + " " + courses[row].getCourseName();
+        };
+        line("--- Enrollment Analytics ---");
+        line("Students: ", stats.students, " (Undergraduate ", stats.studentsByType[0],
+             ", Postgraduate ", stats.studentsByType[1], ")");
+        line("Courses: ", courses.size());
+        line("Enrollments: ", stats.enrollments, " (Undergraduate ", stats.enrollmentsByType[0],
+             ", Postgraduate ", stats.enrollmentsByType[1], ")");
+        line("Courses per student:");
+        for (size_t k = 0; k < stats.coursesPerStudent.size(); ++k)
+            if (stats.coursesPerStudent[k])
+                line("  ", k, k == 1 ? " course: " : " courses: ", stats.coursesPerStudent[k],
+                     stats.coursesPerStudent[k] == 1 ? " student" : " students");
+        line("Most enrolled courses:");
+        for (size_t i = 0; i < stats.topCourses.size(); ++i)
+            line("  ", i + 1, ". ", course(stats.topCourses[i]), ": ", stats.perCourse[stats.topCourses[i]]);
+        line("Most common course pairs:");
+        for (size_t i = 0; i < stats.topPairs.size(); ++i)
+            line("  ", i + 1, ". ", courseCodes.str(courses[stats.topPairs[i].first].getCourseCode()), " + ",
+                 courseCodes.str(courses[stats.topPairs[i].second].getCourseCode()), ": ",
+                 stats.topPairs[i].students);
+    }
+
+    // ----------------------------
+    // Change Files
+    // ----------------------------
+    // A delta export writes Changes/changes-<UTC time>.csv holding only the
+    // records changed since the previous export:
+    //   Record,Action,Key,Name,Type,Enrollment
+    //   student,upsert,S001,Alice Johnson,Undergraduate,CSE101;CSE102
+    //   course,upsert,CSE101,Introduction to Programming,,S001;S002
+    //   student,delete,S003,,,
+    // Upserts carry the same fields as the record's row in the full CSV.
+    // Applying the change files in name order on top of the full CSVs they
+    // are newer than gives the current data. A full export folds them in
+    // and removes them.
+    static constexpr const char *kChangeDir = "Changes";
+    static constexpr size_t kConsolidateFiles = 24;
+
+    // Name for a new change file; the timestamp has millisecond resolution
+    // and a counter is added in the unlikely case it is taken.
+    static string newChangeFileName() {
+        using namespace chrono;
+        auto now = system_clock::now();
+        time_t seconds = system_clock::to_time_t(now);
+        tm utc{};
+#if SMS_POSIX
+        gmtime_r(&seconds, &utc);
+#else
+        gmtime_s(&utc, &seconds);
+#endif
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%S", &utc);
+        long millis = long(duration_cast<milliseconds>(now.time_since_epoch()).count() % 1000);
+        char suffix[8];
+        snprintf(suffix, sizeof(suffix), "%03ld", millis);
+        string base = string(kChangeDir) + "/changes-" + stamp + suffix + "Z";
+        string name = exportName(base + ".csv");
+        error_code ec;
+        for (int n = 2; fs::exists(name, ec); ++n)
+            name = exportName(base + "-" + to_string(n) + ".csv");
+        return name;
+    }
+
+    // Change files written since the last full export, plain or LZ4.
+    static vector<fs::path> changeFiles() {
+        vector<fs::path> files;
+        error_code ec;
+        auto endsWith = [](const string &name, string_view suffix) {
+            return name.size() > 8 + suffix.size() &&
+                   name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        for (fs::directory_iterator it(kChangeDir, ec), end; !ec && it != end; it.increment(ec)) {
+            string name = it->path().filename().string();
+            if (name.compare(0, 8, "changes-") == 0 && (endsWith(name, ".csv") || endsWith(name, ".csv.lz4")))
+                files.push_back(it->path());
+        }
+        sort(files.begin(), files.end());
+        return files;
+    }
+
+    // A delta export should consolidate instead once there is no full CSV
+    // to apply changes to, kConsolidateFiles change files have piled up,
+    // or together they reach a quarter of the full CSVs' size.
+    static bool consolidationDue() {
+        error_code ec;
+        uintmax_t full = 0, changes = 0;
+        for (const char *csv : {"Students/students.csv", "Courses/courses.csv"}) {
+            uintmax_t size = fs::file_size(dataFileName(csv), ec);
+            if (ec)
+                return true;
+            full += size;
+        }
+        vector<fs::path> files = changeFiles();
+        for (const fs::path &file : files) {
+            uintmax_t size = fs::file_size(file, ec);
+            changes += ec ? 0 : size;
+        }
+        return files.size() >= kConsolidateFiles || changes * 4 >= full;
+    }
+
+    // Drop the change files once a full export has folded them in.
+    static size_t removeChangeFiles() {
+        size_t removed = 0;
+        for (const fs::path &file : changeFiles()) {
+            error_code ec;
+            removed += fs::remove(file, ec) ? 1 : 0;
+        }
+        return removed;
+    }
+
+    // Write the records behind `marks` to a new change file: an upsert per
+    // record that still exists and a delete per one that does not.
+    Status writeChangeFile(const ChangeMarks &marks, MessageSink &messages, string &buffer) const {
+        OpTimer timer(Op::ExportDelta);
+        ensureDirectory(kChangeDir);
+        string filename = newChangeFileName();
+        AtomicFileWriter file(buffer);
+        if (!file.open(filename, compressExports())) {
+            messages.write("Error opening file for exporting changes.\n");
+            return Status::IoError;
+        }
+        string &out = file.out();
+        out.append("Record,Action,Key,Name,Type,Enrollment\n");
+        size_t upserts = 0, deletes = 0;
+        vector<uint32_t> handles = marks.students;
+        sort(handles.begin(), handles.end());
+        for (uint32_t id : handles) {
+            int row = slotOf(studentIndex, id);
+            if (row == -1) {
+                out.append("student,delete,").append(studentIDs.str(id)).append(",,,\n");
+                deletes++;
+            } else {
+                out.append("student,upsert,");
+                appendStudentRow(out, size_t(row));
+                upserts++;
+            }
+            file.flushIfFull();
+        }
+        handles = marks.courses;
+        sort(handles.begin(), handles.end());
+        for (uint32_t code : handles) {
+            int row = slotOf(courseIndex, code);
+            if (row == -1) {
+                out.append("course,delete,").append(courseCodes.str(code)).append(",,,\n");
+                deletes++;
+            } else {
+                out.append("course,upsert,").append(courseCodes.str(code)).push_back(',');
+                out.append(courses[row].getCourseName()).append(",,");
+                bool first = true;
+                enrollment.forEachStudent(code, [&](uint32_t id) {
+                    if (!first)
+                        out.push_back(';');
+                    out.append(studentIDs.str(id));
+                    first = false;
+                });
+                out.push_back('\n');
+                upserts++;
+            }
+            file.flushIfFull();
+        }
+        if (withholdDamaged(messages, "Changes"))
+            return Status::IoError;
+        if (!file.commit()) {
+            messages.write("Error writing file for exporting changes.\n");
+            return Status::IoError;
+        }
+        messages.write("Exported ", upserts, " changed and ", deletes, " removed records to ", filename, "\n");
+        return Status::Ok;
+    }
+
+    // Enrollment count of every course, one CSV row per course in table order.
+    void appendCourseCounts(string &out, const EnrollmentAnalytics &stats) const {
+        out.append("CourseCode,CourseName,EnrolledStudents\n");
+        for (size_t row = 0; row < courses.size(); ++row) {
+            out.append(courseCodes.str(courses[row].getCourseCode())).push_back(',');
+            out.append(courses[row].getCourseName()).push_back(',');
+            out.append(to_string(stats.perCourse[row])).push_back('\n');
+        }
+    }
+};
+
+// ----------------------------
+// Class: StudentManagement
+// ----------------------------
+class StudentManagement : private ModelData {
+private:
+    // Write-ahead log of mutations since the last snapshot, and the
+    // checksum of that snapshot (0 if the state came from CSV).
+    OperationLog oplog;
+    uint64_t snapshotChecksum = 0;
+
+    // Format buffer reused by every CSV export.
+    string exportBuffer;
+
+    // Status messages from mutations, exports and snapshots.
+    MessageSink messages;
+
+    // Search indexes: student handle by trigrams of its name and ID, and
+    // course code handle by trigrams of the code. Matches through enrolled
+    // courses go code -> enrollment graph, so enrolling needs no update.
+    // They are built on the first indexed search (so bulk loads pay nothing)
+    // and maintained incrementally by add/remove from then on.
+    mutable TrigramIndex studentTextIndex;
+    mutable TrigramIndex courseCodeIndex;
+    mutable atomic<bool> searchIndexReady{false};
+    mutable mutex searchIndexLock;
+
+    // Report rows per course handle (its roster) and per student handle
+    // (their courses), kept in step by the mutations below.
+    ReportCache courseReports;
+    ReportCache studentReports;
+
+    // Students and courses changed since the last export, full or delta,
+    // so a delta export can write just those. Taking them is logged, and
+    // the snapshot keeps them, so they survive a restart.
+    DirtySet changedStudents;
+    DirtySet changedCourses;
+
+    void markChanged(uint32_t id, uint32_t code) {
+        changedStudents.mark(id);
+        changedCourses.mark(code);
+    }
+
+    // Paged listing orders: student handles per ListOrder, course code
+    // handles by code and by name. Each is built by the first page in its
+    // order and then kept in step by the record inserts and removals.
+    SortedColumn studentOrders[3];
+    SortedColumn courseOrders[2];
+
+    // Seats per course code handle. A course with capacity 0 is unlimited;
+    // otherwise a seat is free while its enrolled count plus the seats
+    // reserved by claimSeat() is below capacity. Only `reserved` changes
+    // without the writer lock: claimSeat() takes seats by compare-and-swap
+    // under the server's shared lock, so concurrent enrolls never queue on
+    // a mutex to find out whether they got in. Waitlists are in ticket
+    // order and promoted from the front whenever a seat frees up.
+    struct Waiter {
+        uint64_t ticket;
+        uint32_t id;
+    };
+
+    struct CourseSeats {
+        uint32_t capacity = 0;
+        uint32_t generation = 0; // bumped when the course is removed
+        atomic<uint32_t> reserved{0};
+        vector<Waiter> waitlist;
+    };
+
+    deque<CourseSeats> seats; // grows under the writer lock only
+    atomic<uint64_t> nextTicket{0};
+    size_t waitlisted = 0;    // entries across every waitlist
+
+    CourseSeats *seatsOf(uint32_t code) { return code < seats.size() ? &seats[code] : nullptr; }
+    const CourseSeats *seatsOf(uint32_t code) const { return code < seats.size() ? &seats[code] : nullptr; }
+
+    CourseSeats &seatsFor(uint32_t code) {
+        while (seats.size() <= code)
+            seats.emplace_back();
+        return seats[code];
+    }
+
+    bool hasFreeSeat(const CourseSeats &s, uint32_t code) const {
+        return s.capacity == 0 || enrollment.studentCount(code) + s.reserved.load() < s.capacity;
+    }
+
+    bool isWaiting(const CourseSeats &s, uint32_t id) const {
+        return any_of(s.waitlist.begin(), s.waitlist.end(), [&](const Waiter &w) { return w.id == id; });
+    }
+
+    void addWaiter(CourseSeats &s, uint32_t id, uint64_t ticket) {
+        auto at = upper_bound(s.waitlist.begin(), s.waitlist.end(), ticket,
+                              [](uint64_t t, const Waiter &w) { return t < w.ticket; });
+        s.waitlist.insert(at, Waiter{ticket, id});
+        waitlisted++;
+    }
+
+    bool removeWaiter(CourseSeats &s, uint32_t id) {
+        auto it = find_if(s.waitlist.begin(), s.waitlist.end(), [&](const Waiter &w) { return w.id == id; });
+        if (it == s.waitlist.end())
+            return false;
+        s.waitlist.erase(it);
+        waitlisted--;
+        return true;
+    }
+
+    // Move waitlisted students into free seats, first come first served.
+    // Each promotion is logged as an enroll.
+    void promoteWaitlist(uint32_t code) {
+        CourseSeats *s = seatsOf(code);
+        if (!s)
+            return;
+        size_t taken = 0;
+        while (taken < s->waitlist.size() && hasFreeSeat(*s, code)) {
+            uint32_t id = s->waitlist[taken++].id;
+            if (!enrollment.link(id, code))
+                continue;
+            noteLinked(id, code);
+            logOperation(LogOp::Enroll, {studentIDs.str(id), courseCodes.str(code)});
+            messages.write("Student ", studentIDs.str(id), " promoted from the waitlist of course ",
+                           courseCodes.str(code), "\n");
+        }
+        s->waitlist.erase(s->waitlist.begin(), s->waitlist.begin() + taken);
+        waitlisted -= taken;
+    }
+
+    // Enroll (student, course) handles, or waitlist the student with the
+    // given ticket when the course is full. With `seat` the caller's
+    // claimed seat was just handed back and the waitlist is not consulted.
+    Status enrollOrWaitlist(uint32_t id, uint32_t code, uint64_t ticket, bool seat) {
+        string_view studentID = studentIDs.str(id), courseCode = courseCodes.str(code);
+        // UPDATED: Check if the student is already enrolled in the course.
+        if (enrollment.contains(id, code)) {
+            messages.write("Student ", studentID, " is already enrolled in course ", courseCode, ".\n");
+            return Status::AlreadyEnrolled;
+        }
+        CourseSeats *s = seatsOf(code);
+        if (s && !(hasFreeSeat(*s, code) && (seat || s->waitlist.empty()))) {
+            if (!isWaiting(*s, id)) {
+                addWaiter(*s, id, ticket);
+                logOperation(LogOp::Waitlist, {studentID, courseCode});
+            }
+            messages.write("Course ", courseCode, " is full; student ", studentID, " is on its waitlist (",
+                           s->waitlist.size(), " waiting).\n");
+            return Status::Waitlisted;
+        }
+        if (s)
+            removeWaiter(*s, id);
+        enrollment.link(id, code);
+        noteLinked(id, code);
+        logOperation(LogOp::Enroll, {studentID, courseCode});
+        messages.write("Enrolled student ", studentID, " in course ", courseCode, "\n");
+        return Status::Ok;
+    }
+
+    // What a listing sorts on, read from the model or from a cursor.
+    struct StudentListKey {
+        string_view id;
+        uint64_t packed; // InternTable::kUnpacked if the ID has no packed form
+        string_view name;
+        StudentType type;
+    };
+
+    struct CourseListKey {
+        string_view code;
+        string_view name;
+    };
+
+    StudentListKey studentListKey(uint32_t id) const {
+        size_t row = studentIndex[id];
+        return {studentIDs.str(id), studentIDs.key(id), students.name(row), students.type(row)};
+    }
+
+    CourseListKey courseListKey(uint32_t code) const {
+        return {courseCodes.str(code), courses[courseIndex[code]].getCourseName()};
+    }
+
+    static bool listLess(ListOrder order, const StudentListKey &a, const StudentListKey &b) {
+        if (order == ListOrder::Name && a.name != b.name)
+            return a.name < b.name;
+        if (order == ListOrder::Type && a.type != b.type)
+            return strcmp(studentTypeName(a.type), studentTypeName(b.type)) < 0;
+        if (a.packed != InternTable::kUnpacked && b.packed != InternTable::kUnpacked)
+            return a.packed < b.packed;
+        return a.id < b.id;
+    }
+
+    static bool listLess(ListOrder order, const CourseListKey &a, const CourseListKey &b) {
+        if (order == ListOrder::Name && a.name != b.name)
+            return a.name < b.name;
+        return a.code < b.code;
+    }
+
+    // Handles of rows [0, count) in listing order. The keys are read once
+    // up front, so the sort itself never goes back to the model.
+    template <typename KeyOf>
+    static vector<uint32_t> sortedByKey(size_t count, KeyOf keyOf, ListOrder order) {
+        using Keyed = decltype(keyOf(size_t()));
+        vector<Keyed> keyed;
+        keyed.reserve(count);
+        for (size_t row = 0; row < count; ++row)
+            keyed.push_back(keyOf(row));
+        sort(keyed.begin(), keyed.end(),
+             [order](const Keyed &a, const Keyed &b) { return listLess(order, a.first, b.first); });
+        vector<uint32_t> handles;
+        handles.reserve(count);
+        for (const Keyed &k : keyed)
+            handles.push_back(k.second);
+        return handles;
+    }
+
+    auto studentOrderLess(ListOrder order) const {
+        return [this, order](uint32_t a, uint32_t b) { return listLess(order, studentListKey(a), studentListKey(b)); };
+    }
+
+    auto courseOrderLess(ListOrder order) const {
+        return [this, order](uint32_t a, uint32_t b) { return listLess(order, courseListKey(a), courseListKey(b)); };
+    }
+
+    // Append a course row and keep the slot index and listing orders in step.
+    void insertCourseRecord(string_view courseName, uint32_t code) {
+        applyAddCourse(courseName, code);
+        for (SortedColumn &column : courseOrders)
+            column.add(code);
+    }
+
+    static void setSlot(SlotIndex &index, uint32_t handle, uint32_t slot) {
+        if (handle >= index.size())
+            index.resize(handle + 1, kNoSlot);
+        index.edit(handle) = slot;
+    }
+
+    // Append a student row and keep the slot and search indexes in step.
+    uint32_t insertStudentRecord(string_view studentID, string_view name, StudentType type) {
+        uint32_t id = applyAddStudent(studentID, name, type);
+        for (SortedColumn &column : studentOrders)
+            column.add(id);
+        if (searchIndexReady) {
+            studentTextIndex.add(id, name);
+            studentTextIndex.add(id, studentID);
+        }
+        // Rosters that already listed this ID skipped it while it had no row.
+        invalidateCourseReportsOf(id);
+        return id;
+    }
+
+    // Intern a course code, indexing it for search the first time it is seen.
+    uint32_t internCourseCode(string_view courseCode) {
+        size_t before = courseCodes.size();
+        uint32_t code = courseCodes.intern(courseCode);
+        if (searchIndexReady && courseCodes.size() != before)
+            courseCodeIndex.add(code, courseCode);
+        return code;
+    }
+
+    // Report cache upkeep. A new edge lands at the end of both lists, so
+    // cached bodies are patched; every other change invalidates them.
+    void invalidateCourseReportsOf(uint32_t id) {
+        if (!courseReports.empty())
+            enrollment.forEachCourse(id, [&](uint32_t code) { courseReports.invalidate(code); });
+    }
+
+    void invalidateStudentReportsOf(uint32_t code) {
+        if (!studentReports.empty())
+            enrollment.forEachStudent(code, [&](uint32_t id) { studentReports.invalidate(id); });
+    }
+
+    void noteLinked(uint32_t id, uint32_t code) {
+        markChanged(id, code);
+        if (string *rows = courseReports.find(code))
+            appendRosterLine(*rows, id);
+        if (string *rows = studentReports.find(id))
+            appendCourseLine(*rows, code);
+    }
+
+    void noteUnlinked(uint32_t id, uint32_t code) {
+        markChanged(id, code);
+        courseReports.invalidate(code);
+        studentReports.invalidate(id);
+    }
+
+    // Build both search indexes from the current tables, once.
+    void ensureSearchIndex() const {
+        if (searchIndexReady.load(memory_order_acquire))
+            return;
+        lock_guard<mutex> guard(searchIndexLock);
+        if (searchIndexReady.load(memory_order_relaxed))
+            return;
+        for (size_t row = 0; row < students.size(); ++row) {
+            studentTextIndex.add(students.id(row), students.name(row));
+            studentTextIndex.add(students.id(row), studentIDs.str(students.id(row)));
+        }
+        for (uint32_t code = 0; code < courseCodes.size(); ++code)
+            courseCodeIndex.add(code, courseCodes.str(code));
+        searchIndexReady.store(true, memory_order_release);
+    }
+
+    // Erasing from the middle shifts every later slot down by one,
+    // so re-point their index entries starting at the erased position.
+    void reindexStudentsFrom(size_t first) {
+        SlotIndex::Editor slots(studentIndex);
+        for (size_t i = first; i < students.size(); ++i)
+            slots[students.id(i)] = static_cast<uint32_t>(i);
+    }
+
+    void reindexCoursesFrom(size_t first) {
+        SlotIndex::Editor slots(courseIndex);
+        for (size_t i = first; i < courses.size(); ++i)
+            slots[courses[i].getCourseCode()] = static_cast<uint32_t>(i);
+    }
+
+    void printStudent(size_t row) const {
+        cout << "Name: " << students.name(row)
+             << ", ID: " << studentIDs.str(students.id(row))
+             << ", Type: " << studentTypeName(students.type(row)) << "\n";
+    }
+
+    static constexpr size_t kListFlushBytes = 64 * 1024;
+
+    void appendCourseListLine(string &out, size_t row) const {
+        out.append("Course Name: ").append(courses[row].getCourseName());
+        out.append(", Course Code: ").append(courseCodes.str(courses[row].getCourseCode())).push_back('\n');
+    }
+
+    void appendStudentLine(string &out, size_t row) const {
+        out.append("Name: ").append(students.name(row));
+        out.append(", ID: ").append(studentIDs.str(students.id(row)));
+        out.append(", Type: ").append(studentTypeName(students.type(row))).push_back('\n');
+    }
+
+    // Merge parsed rows into the model. Duplicates follow addStudent/addCourse:
+    // the first row for an ID wins and later rows only contribute their
+    // enrollments. Rows are applied in file order, so the result does not
+    // depend on how the file was chunked.
+    void applyStudentRows(const CsvBatch &batch) {
+        for (const CsvRow &row : batch.rows) {
+            int sIdx = findStudentIndex(row.key);
+            uint32_t id;
+            if (sIdx != -1) {
+                id = students.id(sIdx);
+            } else {
+                StudentType type;
+                if (!parseStudentType(row.type, type))
+                    continue;
+                id = insertStudentRecord(row.key, row.name, type);
+            }
+            for (size_t i = 0; i < row.refCount; ++i) {
+                uint32_t code = internCourseCode(batch.refs[row.firstRef + i]);
+                if (enrollment.link(id, code))
+                    markChanged(id, code);
+            }
+        }
+    }
+
+    void applyCourseRows(const CsvBatch &batch) {
+        for (const CsvRow &row : batch.rows) {
+            int cIdx = findCourseIndex(row.key);
+            uint32_t code;
+            if (cIdx != -1) {
+                code = courses[cIdx].getCourseCode();
+            } else {
+                code = internCourseCode(row.key);
+                insertCourseRecord(row.name, code);
+            }
+            for (size_t i = 0; i < row.refCount; ++i) {
+                uint32_t id = studentIDs.intern(batch.refs[row.firstRef + i]);
+                enrollment.linkInCourseOrder(id, code);
+                markChanged(id, code);
+            }
+        }
+    }
+
+    // Return the file contents after the header line.
+    static string_view csvBody(const MappedFile &file) {
+        string_view text = file.view(), header;
+        nextLine(text, header);
+        return text;
+    }
+
+    // Record a successful mutation; compacts into a snapshot once the log
+    // has grown large. No-op until openLog() has run.
+    void logOperation(LogOp op, initializer_list<string_view> fields) {
+        if (!oplog.isActive())
+            return;
+        oplog.append(op, fields);
+        compactLogIfLarge();
+    }
+
+    // Checkpoint once the log has grown large, but not in the middle of a
+    // batch: enrollBatch() checks once it is done.
+    bool loggingBatch = false;
+
+    void compactLogIfLarge() {
+        if (loggingBatch || oplog.size() <= kLogCompactBytes)
+            return;
+        MessageScope quiet(messages, MessageMode::None);
+        checkpoint();
+    }
+
+    // The change each logged operation makes, on rows the caller has
+    // already looked up. The public mutators check their arguments, apply
+    // and then log and report; the CSV loaders and replay only apply, so
+    // nothing they do is printed or logged. The search indexes, report caches
+    // and listing orders are left to the callers: replay runs before any of
+    // them is built. The change marks are set here, replay included: marks
+    // made after the snapshot are only in the log, and the next delta export
+    // needs them.
+    uint32_t applyAddStudent(string_view studentID, string_view name, StudentType type) {
+        uint32_t id = studentIDs.intern(studentID);
+        students.append(id, name, type);
+        setSlot(studentIndex, id, static_cast<uint32_t>(students.size() - 1));
+        changedStudents.mark(id);
+        return id;
+    }
+
+    void applyRemoveStudent(size_t row) {
+        uint32_t id = students.id(row);
+        // Their places in line are dropped; the seats they held are not
+        // handed on here.
+        if (waitlisted) {
+            for (CourseSeats &s : seats)
+                removeWaiter(s, id);
+        }
+        // Remove student from any enrolled courses
+        changedStudents.mark(id);
+        enrollment.forEachCourse(id, [&](uint32_t code) { changedCourses.mark(code); });
+        enrollment.removeStudent(id);
+        students.erase(row);
+        studentIndex.edit(id) = kNoSlot;
+        reindexStudentsFrom(row);
+    }
+
+    void applyAddCourse(string_view courseName, uint32_t code) {
+        courses.push_back(Course(courseName, code));
+        setSlot(courseIndex, code, static_cast<uint32_t>(courses.size() - 1));
+        changedCourses.mark(code);
+    }
+
+    void applyRemoveCourse(size_t row) {
+        uint32_t code = courses[row].getCourseCode();
+        // Remove course from students' enrolled lists
+        changedCourses.mark(code);
+        enrollment.forEachStudent(code, [&](uint32_t id) { changedStudents.mark(id); });
+        enrollment.removeCourse(code);
+        if (CourseSeats *s = seatsOf(code)) {
+            waitlisted -= s->waitlist.size();
+            s->waitlist.clear();
+            s->capacity = 0;
+            s->reserved = 0;
+            s->generation++;
+        }
+        courses.erase(row);
+        courseIndex.edit(code) = kNoSlot;
+        reindexCoursesFrom(row);
+    }
+
+public:
+    // Status messages default to the console. Loaders and replay print
+    // nothing, since they only apply rows; other callers switch the sink
+    // off (or to Buffered) around work that should not print.
+    MessageSink &messageSink() { return messages; }
+
+    // Pin the current state as an immutable version (see ModelData). Call
+    // with writers excluded; the version can then be exported or reported
+    // from without holding anything, while writers carry on. Release it
+    // with writers excluded too, as it may free chunks in arena mode.
+    shared_ptr<const ModelData> pinVersion() const {
+        return make_shared<const ModelData>(static_cast<const ModelData &>(*this));
+    }
+
+    // ----------------------------
+    // Student Management Functions
+    // ----------------------------
+    Status addStudent(const string &name, const string &studentID, const string &type) {
+        OpTimer timer(Op::AddStudent);
+        // Prevent duplicate student IDs.
+        if (findStudentIndex(studentID) != -1) {
+            messages.write("Student with ID ", studentID, " already exists.\n");
+            return Status::StudentExists;
+        }
+        StudentType parsedType;
+        if (!parseStudentType(type, parsedType)) {
+            messages.write("Unknown student type. Please use 'Undergraduate' or 'Postgraduate'.\n");
+            return Status::UnknownStudentType;
+        }
+        insertStudentRecord(studentID, name, parsedType);
+        logOperation(LogOp::AddStudent, {studentID, name, type});
+        messages.write("Student added: ", name, " (", type, ")\n");
+        return Status::Ok;
+    }
+
+    Status removeStudent(const string &studentID) {
+        OpTimer timer(Op::RemoveStudent);
+        int idx = findStudentIndex(studentID);
+        if (idx == -1) {
+            messages.write("Student with ID ", studentID, " not found.\n");
+            return Status::StudentNotFound;
+        }
+        uint32_t id = students.id(idx);
+        // Seats this student held go to the waitlists.
+        vector<uint32_t> freed;
+        if (waitlisted) {
+            enrollment.forEachCourse(id, [&](uint32_t code) {
+                const CourseSeats *s = seatsOf(code);
+                if (s && !s->waitlist.empty())
+                    freed.push_back(code);
+            });
+        }
+        invalidateCourseReportsOf(id);
+        studentReports.invalidate(id);
+        if (searchIndexReady) {
+            studentTextIndex.remove(id, students.name(idx));
+            studentTextIndex.remove(id, studentID);
+        }
+        for (size_t i = 0; i < size(studentOrders); ++i)
+            studentOrders[i].remove(id, studentOrderLess(ListOrder(i)));
+        applyRemoveStudent(idx);
+        logOperation(LogOp::RemoveStudent, {studentID});
+        messages.write("Student removed: ", studentID, "\n");
+        for (uint32_t code : freed)
+            promoteWaitlist(code);
+        return Status::Ok;
+    }
+
+    // Every student in table order, written out a few thousand rows at a time.
+    void listStudents() const {
+        cout << "\n--- List of Students ---\n";
+        string out;
+        for (size_t row = 0; row < students.size(); ++row) {
+            appendStudentLine(out, row);
+            if (out.size() >= kListFlushBytes || row + 1 == students.size()) {
+                cout.write(out.data(), out.size());
+                out.clear();
+            }
+        }
+    }
+
+    // One page of at most limit students in the given order, starting after
+    // the row the cursor names (at the top for an empty cursor). nextCursor
+    // is set for the following page, or left empty on the last one. Seeking
+    // is a binary search, so a page costs O(limit + log N) once the order
+    // is built. Returns false for a malformed cursor or one from another
+    // order.
+    bool formatStudentPage(string &out, string &nextCursor, ListOrder order, size_t limit,
+                           string_view cursor = string_view()) {
+        OpTimer timer(Op::ListStudents);
+        SortedColumn &column = studentOrders[size_t(order)];
+        auto less = studentOrderLess(order);
+        if (!column.isBuilt())
+            column.assign(sortedByKey(students.size(), [&](size_t row) {
+                uint32_t id = students.id(row);
+                return make_pair(studentListKey(id), id);
+            }, order));
+        const vector<uint32_t> &ids = column.view(less);
+        const char tag[] = {'s', char('0' + int(order)), '\0'};
+
+        size_t start = 0;
+        if (!cursor.empty()) {
+            string raw;
+            vector<string_view> f;
+            if (!decodeCursor(cursor, raw, f) || f.size() != 4 || f[0] != tag ||
+                (f[3] != "0" && f[3] != "1"))
+                return false;
+            StudentListKey after{f[1], InternTable::kUnpacked, f[2],
+                                 f[3] == "0" ? StudentType::Undergraduate : StudentType::Postgraduate};
+            if (!packStudentID(after.id, after.packed))
+                after.packed = InternTable::kUnpacked;
+            start = size_t(upper_bound(ids.begin(), ids.end(), after, [&](const StudentListKey &k, uint32_t id) {
+                return listLess(order, k, studentListKey(id));
+            }) - ids.begin());
+        }
+        size_t end = min(ids.size(), start + max<size_t>(1, limit));
+        for (size_t i = start; i < end; ++i)
+            appendStudentLine(out, studentIndex[ids[i]]);
+        nextCursor.clear();
+        if (end < ids.size()) {
+            StudentListKey last = studentListKey(ids[end - 1]);
+            nextCursor = encodeCursor({tag, last.id, last.name, last.type == StudentType::Undergraduate ? "0" : "1"});
+        }
+        return true;
+    }
+
+    // Rows of students whose name, ID or an enrolled course code contains
+    // keyword, in table order. Case-sensitive keywords of three or more bytes
+    // go through the trigram indexes; everything else is a full scan.
+    vector<size_t> matchStudents(string_view keyword, bool ignoreCase = false) const {
+        vector<size_t> rows;
+        if (ignoreCase || keyword.size() < TrigramIndex::kGram) {
+            vector<char> hit(students.size(), 0);
+            students.forEachNameMatch(keyword, ignoreCase, [&](size_t row) { hit[row] = 1; });
+            for (size_t row = 0; row < students.size(); ++row)
+                if (!hit[row] && scanFind(studentIDs.str(students.id(row)), keyword, ignoreCase) != string_view::npos)
+                    hit[row] = 1;
+            // Also search in enrolled courses: test each distinct code once,
+            // then mark the students enrolled in the matching ones.
+            for (uint32_t code = 0; code < courseCodes.size(); ++code) {
+                if (scanFind(courseCodes.str(code), keyword, ignoreCase) == string_view::npos)
+                    continue;
+                enrollment.forEachStudent(code, [&](uint32_t id) {
+                    int row = slotOf(studentIndex, id);
+                    if (row != -1)
+                        hit[row] = 1;
+                });
+            }
+            for (size_t row = 0; row < students.size(); ++row)
+                if (hit[row])
+                    rows.push_back(row);
+            return rows;
+        }
+
+        ensureSearchIndex();
+        vector<uint32_t> candidates;
+        studentTextIndex.candidates(keyword, candidates);
+        for (uint32_t id : candidates) {
+            int row = slotOf(studentIndex, id);
+            if (row != -1 && (students.name(row).find(keyword) != string_view::npos ||
+                              studentIDs.str(id).find(keyword) != string_view::npos))
+                rows.push_back(row);
+        }
+        // Also search in enrolled courses
+        courseCodeIndex.candidates(keyword, candidates);
+        for (uint32_t code : candidates) {
+            if (courseCodes.str(code).find(keyword) == string_view::npos)
+                continue;
+            enrollment.forEachStudent(code, [&](uint32_t id) {
+                int row = slotOf(studentIndex, id);
+                if (row != -1)
+                    rows.push_back(row);
+            });
+        }
+        sort(rows.begin(), rows.end());
+        rows.erase(unique(rows.begin(), rows.end()), rows.end());
+        return rows;
+    }
+
+    void searchStudent(const string &keyword, bool ignoreCase = false) const {
+        OpTimer timer(Op::Search);
+        cout << "\n--- Search Results for \"" << keyword << "\" ---\n";
+        vector<size_t> rows = matchStudents(keyword, ignoreCase);
+        for (size_t row : rows)
+            printStudent(row);
+        if (rows.empty())
+            cout << "No matching student found.\n";
+    }
+
+    // Read-only queries that format into a caller's buffer instead of
+    // printing, for callers that must not touch cout (the server). They
+    // neither print nor fill caches, so concurrent callers only need the
+    // model not to change underneath them.
+    void formatSearch(string &out, string_view keyword, bool ignoreCase = false) const {
+        OpTimer timer(Op::Search);
+        for (size_t row : matchStudents(keyword, ignoreCase))
+            appendStudentLine(out, row);
+    }
+
+    bool formatCourseReport(string &out, string_view courseCode) const {
+        OpTimer timer(Op::ReportCourse);
+        int cIdx = findCourseIndex(courseCode);
+        if (cIdx == -1)
+            return false;
+        appendCourseReport(out, cIdx, &courseReports);
+        return true;
+    }
+
+    bool formatStudentReport(string &out, string_view studentID) const {
+        OpTimer timer(Op::ReportStudent);
+        int sIdx = findStudentIndex(studentID);
+        if (sIdx == -1)
+            return false;
+        appendStudentReport(out, sIdx, &studentReports);
+        return true;
+    }
+
+    // ----------------------------
+    // Course Management Functions
+    // ----------------------------
+    Status addCourse(const string &courseName, const string &courseCode) {
+        OpTimer timer(Op::AddCourse);
+        if (findCourseIndex(courseCode) != -1) {
+            messages.write("Course with code ", courseCode, " already exists.\n");
+            return Status::CourseExists;
+        }
+        uint32_t code = internCourseCode(courseCode);
+        insertCourseRecord(courseName, code);
+        invalidateStudentReportsOf(code);
+        logOperation(LogOp::AddCourse, {courseCode, courseName});
+        messages.write("Course added: ", courseName, " (", courseCode, ")\n");
+        return Status::Ok;
+    }
+
+    Status removeCourse(const string &courseCode) {
+        OpTimer timer(Op::RemoveCourse);
+        int idx = findCourseIndex(courseCode);
+        if (idx == -1) {
+            messages.write("Course with code ", courseCode, " not found.\n");
+            return Status::CourseNotFound;
+        }
+        uint32_t code = courses[idx].getCourseCode();
+        invalidateStudentReportsOf(code);
+        courseReports.invalidate(code);
+        for (size_t i = 0; i < size(courseOrders); ++i)
+            courseOrders[i].remove(code, courseOrderLess(ListOrder(i)));
+        applyRemoveCourse(idx);
+        logOperation(LogOp::RemoveCourse, {courseCode});
+        messages.write("Course removed: ", courseCode, "\n");
+        return Status::Ok;
+    }
+
+    // Every course in table order, written out a few thousand rows at a time.
+    void listCourses() const {
+        cout << "\n--- List of Courses ---\n";
+        string out;
+        for (size_t row = 0; row < courses.size(); ++row) {
+            appendCourseListLine(out, row);
+            if (out.size() >= kListFlushBytes || row + 1 == courses.size()) {
+                cout.write(out.data(), out.size());
+                out.clear();
+            }
+        }
+    }
+
+    // One page of courses in the given order, after the row the cursor
+    // names; see formatStudentPage.
+    bool formatCoursePage(string &out, string &nextCursor, ListOrder order, size_t limit,
+                          string_view cursor = string_view()) {
+        OpTimer timer(Op::ListCourses);
+        if (order == ListOrder::Type)
+            return false;
+        SortedColumn &column = courseOrders[size_t(order)];
+        auto less = courseOrderLess(order);
+        if (!column.isBuilt())
+            column.assign(sortedByKey(courses.size(), [&](size_t row) {
+                uint32_t code = courses[row].getCourseCode();
+                return make_pair(courseListKey(code), code);
+            }, order));
+        const vector<uint32_t> &codes = column.view(less);
+        const char tag[] = {'c', char('0' + int(order)), '\0'};
+
+        size_t start = 0;
+        if (!cursor.empty()) {
+            string raw;
+            vector<string_view> f;
+            if (!decodeCursor(cursor, raw, f) || f.size() != 3 || f[0] != tag)
+                return false;
+            CourseListKey after{f[1], f[2]};
+            start = size_t(upper_bound(codes.begin(), codes.end(), after, [&](const CourseListKey &k, uint32_t code) {
+                return listLess(order, k, courseListKey(code));
+            }) - codes.begin());
+        }
+        size_t end = min(codes.size(), start + max<size_t>(1, limit));
+        for (size_t i = start; i < end; ++i)
+            appendCourseListLine(out, courseIndex[codes[i]]);
+        nextCursor.clear();
+        if (end < codes.size()) {
+            CourseListKey last = courseListKey(codes[end - 1]);
+            nextCursor = encodeCursor({tag, last.code, last.name});
+        }
+        return true;
+    }
+
+    // ----------------------------
+    // Enrollment Functions
+    // ----------------------------
+    // Enrolls the student if the course has a free seat and adds them to
+    // its waitlist (returning Waitlisted) if not.
+    Status enrollStudentInCourse(const string &studentID, const string &courseCode) {
+        return enrollStudentInCourse(studentID, courseCode, claimSeat(courseCode));
+    }
+
+    // Enroll using a seat claimed earlier with claimSeat(). The claimed seat
+    // is handed back first (the writer lock is held, so nobody can take it
+    // in between) and then goes to this student ahead of the waitlist; a
+    // claim that holds no seat only waitlists in the claim's ticket order.
+    Status enrollStudentInCourse(const string &studentID, const string &courseCode, const SeatClaim &claim) {
+        OpTimer timer(Op::Enroll);
+        CourseSeats *claimed = claim.held ? seatsOf(claim.code) : nullptr;
+        if (claimed && claimed->generation == claim.generation)
+            claimed->reserved.fetch_sub(1);
+        else
+            claimed = nullptr;
+
+        int sIdx = findStudentIndex(studentID);
+        int cIdx = findCourseIndex(courseCode);
+        Status status = Status::Ok;
+        if (sIdx == -1) {
+            messages.write("Student with ID ", studentID, " not found.\n");
+            status = Status::StudentNotFound;
+        } else if (cIdx == -1) {
+            messages.write("Course with code ", courseCode, " not found.\n");
+            status = Status::CourseNotFound;
+        } else {
+            uint32_t id = students.id(sIdx), code = courses[cIdx].getCourseCode();
+            status = enrollOrWaitlist(id, code, claim.ticket, claimed && claim.code == code);
+        }
+        if (claimed && status != Status::Ok)
+            promoteWaitlist(claim.code);
+        return status;
+    }
+
+    // Reserve a seat for the enroll that follows, and take a place in
+    // line. Safe to call concurrently under a shared lock on the model:
+    // the seat is taken by compare-and-swap, so of many callers racing for
+    // the last seat exactly one holds it and the rest hold none. Courses
+    // without a capacity, or with students already waiting, hand out no
+    // seats here.
+    SeatClaim claimSeat(string_view courseCode) {
+        SeatClaim claim;
+        claim.ticket = nextTicket.fetch_add(1);
+        int cIdx = findCourseIndex(courseCode);
+        if (cIdx == -1)
+            return claim;
+        claim.code = courses[cIdx].getCourseCode();
+        CourseSeats *s = seatsOf(claim.code);
+        if (!s || s->capacity == 0)
+            return claim;
+        claim.generation = s->generation;
+        if (!s->waitlist.empty())
+            return claim;
+        uint32_t enrolled = enrollment.studentCount(claim.code);
+        uint32_t reserved = s->reserved.load();
+        while (enrolled + reserved < s->capacity) {
+            if (s->reserved.compare_exchange_weak(reserved, reserved + 1)) {
+                claim.held = true;
+                break;
+            }
+        }
+        return claim;
+    }
+
+    // Limit a course to `capacity` students; 0 removes the limit. Students
+    // already enrolled keep their seats when the limit drops below them,
+    // and raising it promotes from the waitlist.
+    Status setCourseCapacity(const string &courseCode, uint32_t capacity) {
+        OpTimer timer(Op::SetCapacity);
+        int cIdx = findCourseIndex(courseCode);
+        if (cIdx == -1) {
+            messages.write("Course with code ", courseCode, " not found.\n");
+            return Status::CourseNotFound;
+        }
+        uint32_t code = courses[cIdx].getCourseCode();
+        seatsFor(code).capacity = capacity;
+        logOperation(LogOp::SetCapacity, {courseCode, to_string(capacity)});
+        if (capacity)
+            messages.write("Capacity of course ", courseCode, " set to ", capacity, "\n");
+        else
+            messages.write("Course ", courseCode, " no longer has a capacity limit\n");
+        promoteWaitlist(code);
+        return Status::Ok;
+    }
+
+    // The course's seat count and its waitlist in order. Returns false if
+    // the course does not exist.
+    bool formatCourseSeats(string &out, string_view courseCode) const {
+        int cIdx = findCourseIndex(courseCode);
+        if (cIdx == -1)
+            return false;
+        uint32_t code = courses[cIdx].getCourseCode();
+        const CourseSeats *s = seatsOf(code);
+        uint32_t capacity = s ? s->capacity : 0;
+        size_t waiting = s ? s->waitlist.size() : 0;
+        out.append("Course ").append(courseCode).append(": ").append(to_string(enrollment.studentCount(code)));
+        if (capacity)
+            out.append(" of ").append(to_string(capacity)).append(" seats taken\n");
+        else
+            out.append(" enrolled, no capacity limit\n");
+        out.append("Waitlist: ").append(to_string(waiting)).append(waiting == 1 ? " student\n" : " students\n");
+        for (size_t i = 0; i < waiting; ++i) {
+            out.append("  ").append(to_string(i + 1)).append(". ");
+            out.append(studentIDs.str(s->waitlist[i].id)).push_back('\n');
+        }
+        return true;
+    }
+
+    // Print formatCourseSeats() for the menu.
+    void showCourseSeats(const string &courseCode) const {
+        string out;
+        if (!formatCourseSeats(out, courseCode)) {
+            cout << "Course with code " << courseCode << " not found.\n";
+            return;
+        }
+        cout << out;
+    }
+
+    // Removing a pair that is not enrolled is not an error.
+    Status removeStudentFromCourse(const string &studentID, const string &courseCode) {
+        OpTimer timer(Op::Unenroll);
+        int sIdx = findStudentIndex(studentID);
+        int cIdx = findCourseIndex(courseCode);
+        if (sIdx == -1 || cIdx == -1) {
+            messages.write("Either student or course not found.\n");
+            return sIdx == -1 ? Status::StudentNotFound : Status::CourseNotFound;
+        }
+        uint32_t id = students.id(sIdx), code = courses[cIdx].getCourseCode();
+        bool freed = enrollment.unlink(id, code);
+        if (freed) {
+            noteUnlinked(id, code);
+        } else {
+            CourseSeats *s = seatsOf(code);
+            if (!s || !removeWaiter(*s, id)) { // leaving the waitlist instead
+                messages.write("Student ", studentID, " is not enrolled in course ", courseCode, ".\n");
+                return Status::NotEnrolled;
+            }
+        }
+        logOperation(LogOp::RemoveFromCourse, {studentID, courseCode});
+        messages.write("Removed student ", studentID, " from course ", courseCode, "\n");
+        if (freed)
+            promoteWaitlist(code);
+        return Status::Ok;
+    }
+
+    // Enroll every (studentID, courseCode) pair in one go. IDs are resolved
+    // in a single pass, the batch is sorted by (student, course) so
+    // duplicates sit together, and the surviving edges are applied through
+    // EnrollmentGraph::linkAll, so new enrollments land in that order.
+    // Rows for courses with a capacity are taken in row order instead, so
+    // earlier rows get the seats and the rest join the waitlist (reported
+    // as CourseFull). Error rows are 0-based positions in pairs.
+    //
+    // The edges linked in one go are logged as EnrollBatch records of up
+    // to kBatchRecordEdges edges rather than one record each, so the batch
+    // fills no group-commit window of its own and is compacted, if due,
+    // only once it is done; the caller's commitLog() makes it durable.
+    // Capacity rows are logged one record each, as enrolls or waitlist
+    // entries.
+    static constexpr size_t kBatchRecordEdges = 1 << 16;
+
+    EnrollBatchReport enrollBatch(const vector<pair<string_view, string_view>> &pairs) {
+        OpTimer timer(Op::EnrollBatch);
+        struct Pending {
+            uint64_t key; // student handle << 32 | course handle
+            uint32_t row;
+            bool operator<(const Pending &o) const { return key != o.key ? key < o.key : row < o.row; }
+        };
+        EnrollBatchReport report;
+        report.rows = pairs.size();
+        vector<Pending> pending;
+        pending.reserve(pairs.size());
+        for (uint32_t row = 0; row < pairs.size(); ++row) {
+            string_view studentID = pairs[row].first, courseCode = pairs[row].second;
+            if (studentID.empty() || courseCode.empty()) {
+                report.errors.push_back({row, EnrollError::MissingField});
+                continue;
+            }
+            int sIdx = findStudentIndex(studentID);
+            if (sIdx == -1) {
+                report.errors.push_back({row, EnrollError::UnknownStudent});
+                continue;
+            }
+            int cIdx = findCourseIndex(courseCode);
+            if (cIdx == -1) {
+                report.errors.push_back({row, EnrollError::UnknownCourse});
+                continue;
+            }
+            uint64_t key = (static_cast<uint64_t>(students.id(sIdx)) << 32) | courses[cIdx].getCourseCode();
+            pending.push_back({key, row});
+        }
+        sort(pending.begin(), pending.end());
+
+        vector<pair<uint32_t, uint32_t>> edges;
+        vector<Pending> capped;
+        edges.reserve(pending.size());
+        for (size_t i = 0; i < pending.size(); ++i) {
+            uint32_t s = static_cast<uint32_t>(pending[i].key >> 32);
+            uint32_t c = static_cast<uint32_t>(pending[i].key);
+            const CourseSeats *seat = seatsOf(c);
+            if (i > 0 && pending[i - 1].key == pending[i].key)
+                report.errors.push_back({pending[i].row, EnrollError::DuplicateRow});
+            else if (enrollment.contains(s, c))
+                report.errors.push_back({pending[i].row, EnrollError::AlreadyEnrolled});
+            else if (seat && seat->capacity != 0)
+                capped.push_back(pending[i]);
+            else
+                edges.emplace_back(s, c);
+        }
+        enrollment.linkAll(edges);
+        for (const auto &e : edges)
+            noteLinked(e.first, e.second);
+        loggingBatch = oplog.isActive();
+        for (size_t first = 0; loggingBatch && first < edges.size(); first += kBatchRecordEdges) {
+            oplog.beginRecord(LogOp::EnrollBatch);
+            for (size_t i = first; i < min(edges.size(), first + kBatchRecordEdges); ++i) {
+                oplog.appendField(studentIDs.str(edges[i].first));
+                oplog.appendField(courseCodes.str(edges[i].second));
+            }
+            oplog.endRecord();
+        }
+
+        report.enrolled = edges.size();
+
+        sort(capped.begin(), capped.end(), [](const Pending &a, const Pending &b) { return a.row < b.row; });
+        for (const Pending &p : capped) {
+            uint32_t s = static_cast<uint32_t>(p.key >> 32);
+            uint32_t c = static_cast<uint32_t>(p.key);
+            string_view studentID = studentIDs.str(s), courseCode = courseCodes.str(c);
+            CourseSeats &seat = seats[c];
+            if (hasFreeSeat(seat, c) && seat.waitlist.empty()) {
+                enrollment.link(s, c);
+                noteLinked(s, c);
+                logOperation(LogOp::Enroll, {studentID, courseCode});
+                report.enrolled++;
+                continue;
+            }
+            if (!isWaiting(seat, s)) {
+                addWaiter(seat, s, nextTicket++);
+                logOperation(LogOp::Waitlist, {studentID, courseCode});
+            }
+            report.errors.push_back({p.row, EnrollError::CourseFull});
+        }
+        sort(report.errors.begin(), report.errors.end(),
+             [](const EnrollRowError &a, const EnrollRowError &b) { return a.row < b.row; });
+        if (loggingBatch) {
+            loggingBatch = false;
+            compactLogIfLarge();
+        }
+        return report;
+    }
+
+    // Batch enrollment from a CSV of "studentID,courseCode" lines after a
+    // header line. Error rows are 1-based line numbers in the file.
+    // Returns false if the file cannot be opened.
+    bool enrollBatchFromCSV(const string &filename, EnrollBatchReport &report) {
+        MappedFile file(filename);
+        if (!file.isOpen())
+            return false;
+        string_view text = csvBody(file), line;
+        vector<pair<string_view, string_view>> pairs;
+        vector<uint32_t> lineOf;
+        uint32_t lineNo = 1;
+        while (nextLine(text, line)) {
+            ++lineNo;
+            if (line.empty()) continue;
+            string_view studentID = nextField(line, ',');
+            pairs.emplace_back(studentID, nextField(line, ','));
+            lineOf.push_back(lineNo);
+        }
+        report = enrollBatch(pairs);
+        for (EnrollRowError &error : report.errors)
+            error.row = lineOf[error.row];
+        return true;
+    }
+
+    // ----------------------------
+    // Reporting Functions
+    // ----------------------------
+    // Generate report for a given course: displays on terminal and saves as CSV.
+    // The roster rows come from the report cache and are only rebuilt after
+    // the course, or one of its students, changed in a way that cannot be patched.
+    void generateReportForCourse(const string &courseCode) {
+        OpTimer timer(Op::ReportCourse);
+        int cIdx = findCourseIndex(courseCode);
+        if (cIdx == -1) {
+            cout << "Course with code " << courseCode << " not found.\n";
+            return;
+        }
+        cout << "\n--- Course Report for " << courseCode << " ---\n";
+        cout << "StudentID,Name,Type\n";
+
+        string dir = "Reports/CourseReports";
+        ensureDirectory(dir);
+        string filename = dir + "/" + courseCode + ".csv";
+
+        uint32_t code = courses[cIdx].getCourseCode();
+        string *rows = courseReports.find(code);
+        if (!rows) {
+            rows = &courseReports.rebuild(code);
+            enrollment.forEachStudent(code, [&](uint32_t id) { appendRosterLine(*rows, id); });
+        }
+        cout << *rows;
+        if (!writeExportFile(filename, {"StudentID,Name,Type\n", *rows})) {
+            cout << "Error writing file for report.\n";
+            return;
+        }
+        cout << "Course report saved to: " << exportName(filename) << "\n";
+    }
+
+    // Generate report for a specific student: displays on terminal and saves as CSV
+    // UPDATED: Includes student’s own information at the top of the CSV.
+    void generateReportForStudent(const string &studentID) {
+        OpTimer timer(Op::ReportStudent);
+        int sIdx = findStudentIndex(studentID);
+        if (sIdx == -1) {
+            cout << "Student with ID " << studentID << " not found.\n";
+            return;
+        }
+        string_view name = students.name(sIdx);
+        const char *type = studentTypeName(students.type(sIdx));
         // Display student information first
         cout << "\n--- Student Report for " << studentID << " ---\n";
         cout << "StudentID,Name,Type\n";
-        cout << students[sIdx]->getID() << "," << students[sIdx]->getName() << "," << students[sIdx]->getType() << "\n\n";
+        cout << studentID << "," << name << "," << type << "\n\n";
         cout << "CourseCode,CourseName\n";
 
-        string dir = "Reports/StudentReports";
-        ensureDirectory(dir);
-        string filename = dir + "/" + studentID + ".csv";
-        ofstream file(filename);
-        if (!file) {
-            cout << "Error opening file for report.\n";
-            return;
+        string dir = "Reports/StudentReports";
+        ensureDirectory(dir);
+        string filename = dir + "/" + studentID + ".csv";
+
+        uint32_t id = students.id(sIdx);
+        string *rows = studentReports.find(id);
+        if (!rows) {
+            rows = &studentReports.rebuild(id);
+            enrollment.forEachCourse(id, [&](uint32_t code) { appendCourseLine(*rows, code); });
+        }
+        cout << *rows;
+        // Write student info at the top of the file
+        string header = "StudentID,Name,Type\n";
+        header.append(studentID).append(",").append(name).append(",").append(type).append("\n\n");
+        header.append("CourseCode,CourseName\n");
+        if (!writeExportFile(filename, {header, *rows})) {
+            cout << "Error writing file for report.\n";
+            return;
+        }
+        cout << "Student report saved to: " << exportName(filename) << "\n";
+    }
+
+    // Write every course and student report file in one pass, without the
+    // terminal output; see ModelData::writeAllReports.
+    Status generateAllReports(size_t threads = ThreadPool::defaultThreads()) {
+        return writeAllReports(messages, threads, &courseReports, &studentReports);
+    }
+
+    // Print the enrollment analytics with the top `topN` courses and pairs,
+    // and save every course's enrollment count as CSV.
+    Status generateAnalyticsReport(size_t topN = 10, size_t threads = ThreadPool::defaultThreads()) {
+        EnrollmentAnalytics stats = computeAnalytics(topN, threads);
+        string out;
+        appendAnalytics(out, stats);
+        cout << "\n" << out;
+
+        string dir = "Reports";
+        ensureDirectory(dir);
+        string filename = dir + "/course_enrollment.csv";
+        out.clear();
+        appendCourseCounts(out, stats);
+        if (!writeExportFile(filename, {out})) {
+            messages.write("Error writing ", exportName(filename), "\n");
+            return Status::IoError;
+        }
+        messages.write("Enrollment counts per course saved to: ", exportName(filename), "\n");
+        return Status::Ok;
+    }
+
+    // ----------------------------
+    // Data Export Functions
+    // ----------------------------
+    Status exportStudentsToCSV() {
+        OpTimer timer(Op::ExportStudents);
+        string dir = "Students";
+        ensureDirectory(dir);
+        string filename = dir + "/students.csv";
+        AtomicFileWriter file(exportBuffer);
+        if (!file.open(exportName(filename), compressExports())) {
+            messages.write("Error opening file for exporting students.\n");
+            return Status::IoError;
+        }
+        file.out().append("StudentID,Name,Type,EnrolledCourses\n");
+        for (size_t row = 0; row < students.size(); ++row) {
+            appendStudentRow(file.out(), row);
+            file.flushIfFull();
+        }
+        if (withholdDamaged(messages, "Students"))
+            return Status::IoError;
+        if (!file.commit()) {
+            messages.write("Error writing file for exporting students.\n");
+            return Status::IoError;
+        }
+        removeOtherForm(filename);
+        messages.write("Students exported to ", exportName(filename), "\n");
+        return Status::Ok;
+    }
+
+    Status exportCoursesToCSV() {
+        OpTimer timer(Op::ExportCourses);
+        string dir = "Courses";
+        ensureDirectory(dir);
+        string filename = dir + "/courses.csv";
+        AtomicFileWriter file(exportBuffer);
+        if (!file.open(exportName(filename), compressExports())) {
+            messages.write("Error opening file for exporting courses.\n");
+            return Status::IoError;
+        }
+        file.out().append("CourseCode,CourseName,EnrolledStudents\n");
+        for (size_t row = 0; row < courses.size(); ++row) {
+            appendCourseRow(file.out(), row);
+            file.flushIfFull();
+        }
+        if (withholdDamaged(messages, "Courses"))
+            return Status::IoError;
+        if (!file.commit()) {
+            messages.write("Error writing file for exporting courses.\n");
+            return Status::IoError;
+        }
+        removeOtherForm(filename);
+        messages.write("Courses exported to ", exportName(filename), "\n");
+        return Status::Ok;
+    }
+    
+    // Parallel export of both files at once; see ModelData::exportCSV.
+    // Output is byte-identical to exportStudentsToCSV()/exportCoursesToCSV().
+    // The full files take in every change, so the change files are removed.
+    Status exportDataParallel(size_t threads = ThreadPool::defaultThreads()) {
+        ChangeMarks marks = takeChanges();
+        Status status = exportCSV(messages, threads);
+        if (status != Status::Ok) {
+            restoreChanges(marks);
+            return status;
+        }
+        removeChangeFiles();
+        return status;
+    }
+
+    // Write the students and courses changed since the last export as a
+    // change file (see ModelData::writeChangeFile), or consolidate them
+    // into a full export when consolidationDue() says so.
+    Status exportDelta(size_t threads = ThreadPool::defaultThreads()) {
+        if (consolidationDue()) {
+            size_t folded = changeFiles().size();
+            Status status = exportDataParallel(threads);
+            if (status == Status::Ok && folded)
+                messages.write("Consolidated ", folded, " change files into the full CSV files\n");
+            checkpoint();
+            return status;
+        }
+        ChangeMarks marks = takeChanges();
+        if (marks.empty()) {
+            messages.write("No changes since the last export.\n");
+            return Status::Ok;
+        }
+        Status status = writeChangeFile(marks, messages, exportBuffer);
+        if (status != Status::Ok)
+            restoreChanges(marks);
+        return status;
+    }
+
+    // Hand the changed records to an export and unmark them. Logged, so a
+    // restart does not export them again.
+    ChangeMarks takeChanges() {
+        ChangeMarks marks{changedStudents.take(), changedCourses.take()};
+        if (!marks.empty())
+            logOperation(LogOp::ChangesExported, {});
+        return marks;
+    }
+
+    // Mark records again after their export failed. The log already says
+    // they went out, so a checkpoint records that they did not.
+    void restoreChanges(const ChangeMarks &marks) {
+        if (marks.empty())
+            return;
+        for (uint32_t id : marks.students)
+            changedStudents.mark(id);
+        for (uint32_t code : marks.courses)
+            changedCourses.mark(code);
+        MessageScope quiet(messages, MessageMode::None);
+        checkpoint();
+    }
+
+    // ----------------------------
+    // Data Loading Functions (Persistence)
+    // ----------------------------
+    // students.csv may list a course that courses.csv does not have, and
+    // courses.csv a student that students.csv does not. Once both files are
+    // in, drop those edges, so a later add-course or add-student does not
+    // come with enrollments nobody made.
+    void dropOrphanEdges() {
+        for (uint32_t code = 0; code < courseCodes.size(); ++code) {
+            if (slotOf(courseIndex, code) == -1 && enrollment.studentCount(code) != 0)
+                enrollment.removeCourse(code);
+        }
+        for (uint32_t id = 0; id < studentIDs.size(); ++id) {
+            if (slotOf(studentIndex, id) == -1 && enrollment.courseCount(id) != 0)
+                enrollment.removeStudent(id);
+        }
+    }
+
+    // Fast loaders: map the whole file and tokenize it in place. Rows are
+    // applied without the per-row console messages of addStudent/addCourse.
+    // An LZ4 file (or a newer "<filename>.lz4") is decoded a block at a
+    // time as it is parsed. Both return false if the file could not be
+    // opened or is damaged; rows before the damage are kept.
+    bool loadStudentsFast(const string &filename = "Students/students.csv") {
+        OpTimer timer(Op::LoadStudents);
+        CsvBodyReader file(dataFileName(filename));
+        if (!file.isOpen())
+            return false; // File may not exist on first run
+        string_view text, line;
+        CsvBatch batch;
+        while (file.next(text)) {
+            while (nextLine(text, line)) {
+                if (line.empty()) continue;
+                batch.clear();
+                parseCsvRow(line, true, batch);
+                applyStudentRows(batch);
+            }
+        }
+        return !file.failed();
+    }
+
+    bool loadCoursesFast(const string &filename = "Courses/courses.csv") {
+        OpTimer timer(Op::LoadCourses);
+        CsvBodyReader file(dataFileName(filename));
+        if (!file.isOpen())
+            return false; // File may not exist on first run
+        string_view text, line;
+        CsvBatch batch;
+        while (file.next(text)) {
+            while (nextLine(text, line)) {
+                if (line.empty()) continue;
+                batch.clear();
+                parseCsvRow(line, false, batch);
+                applyCourseRows(batch);
+            }
+        }
+        return !file.failed();
+    }
+
+    // Parallel loader: both files are mapped and cut into line-aligned chunks
+    // of at least a few MiB, and every chunk of both files is parsed
+    // concurrently into its own staging batch. The batches are then merged
+    // on this thread in file order, students first, so duplicate handling
+    // and enrollment order match the sequential loaders exactly. An LZ4
+    // file is not chunked: rather than decode all of it into memory, it is
+    // streamed a block at a time by the fast loader when its turn to merge
+    // comes.
+    void loadDataParallel(size_t threads = ThreadPool::defaultThreads()) {
+        const size_t kMinChunk = 4 << 20;
+        MappedFile studentFile(dataFileName("Students/students.csv"));
+        MappedFile courseFile(dataFileName("Courses/courses.csv"));
+        const bool studentsLz4 = studentFile.isOpen() && isLz4(studentFile.view());
+        const bool coursesLz4 = courseFile.isOpen() && isLz4(courseFile.view());
+        auto bodyOf = [](const MappedFile &file, bool lz4) {
+            return file.isOpen() && !lz4 ? csvBody(file) : string_view();
+        };
+        string_view studentText = bodyOf(studentFile, studentsLz4);
+        string_view courseText = bodyOf(courseFile, coursesLz4);
+
+        auto chunksFor = [&](string_view text) {
+            size_t parts = min(threads * 4, text.size() / kMinChunk + 1);
+            return splitAtLines(text, parts);
+        };
+        vector<string_view> studentChunks = chunksFor(studentText);
+        vector<string_view> courseChunks = chunksFor(courseText);
+        vector<CsvBatch> studentBatches(studentChunks.size());
+        vector<CsvBatch> courseBatches(courseChunks.size());
+
+        {
+            OpTimer timer(Op::LoadParse);
+            ThreadPool pool(threads);
+            for (size_t i = 0; i < studentChunks.size(); ++i)
+                pool.submit([&, i] { parseCsvRows(studentChunks[i], true, studentBatches[i]); });
+            for (size_t i = 0; i < courseChunks.size(); ++i)
+                pool.submit([&, i] { parseCsvRows(courseChunks[i], false, courseBatches[i]); });
+            pool.wait();
+        }
+
+        OpTimer timer(Op::LoadMerge);
+        if (studentsLz4)
+            loadStudentsFast();
+        for (const CsvBatch &batch : studentBatches)
+            applyStudentRows(batch);
+        if (coursesLz4)
+            loadCoursesFast();
+        for (const CsvBatch &batch : courseBatches)
+            applyCourseRows(batch);
+    }
+
+    // Merge CSV files in the students.csv/courses.csv formats into the
+    // current data, with the loaders' duplicate rules. An empty path skips
+    // that file. The merged rows are not logged, so the caller should
+    // checkpoint() afterwards.
+    Status importCSV(const string &studentFile, const string &courseFile) {
+        OpTimer timer(Op::Import);
+        courseReports.clear();
+        studentReports.clear();
+        bool ok = (studentFile.empty() || loadStudentsFast(studentFile)) &&
+                  (courseFile.empty() || loadCoursesFast(courseFile));
+        dropOrphanEdges();
+        return ok ? Status::Ok : Status::IoError;
+    }
+
+    // Wrapper function to load both students and courses.
+    void loadData(LoadMode mode = LoadMode::Fast) {
+        courseReports.clear();
+        studentReports.clear();
+        if (mode == LoadMode::Parallel) {
+            loadDataParallel();
+        } else {
+            loadStudentsFast();
+            loadCoursesFast();
+        }
+        dropOrphanEdges();
+        // What was just read is what the CSVs hold.
+        changedStudents.take();
+        changedCourses.take();
+    }
+
+    // ----------------------------
+    // Binary Snapshot Functions
+    // ----------------------------
+    // The snapshot holds the full in-memory state so startup only has to
+    // copy arrays out of a mapped file. CSV stays the import/export format:
+    // the snapshot is only used while it is at least as new as both CSVs.
+    static constexpr const char *kSnapshotFile = "Snapshots/sms.snap";
+
+    // Header for a snapshot file with the given payload; fills chunkSums
+    // with the checksum table and sets checksum to the table's, which the
+    // log names as its base.
+    static string snapshotHeader(const string &payload, string &chunkSums, uint64_t &checksum) {
+        chunkSums = chunkChecksums(payload);
+        checksum = checksum64(chunkSums);
+        SnapshotWriter header;
+        for (char c : kSnapshotMagic)
+            header.put(c);
+        header.put<uint32_t>(kSnapshotVersion);
+        header.put<uint32_t>(0);
+        header.put<uint64_t>(payload.size());
+        header.put<uint64_t>(checksum);
+        return header.data();
+    }
+
+    // The snapshot sections after ModelData::putSnapshot(): capacity and
+    // waitlist per course row.
+    void putSeats(SnapshotWriter &out) const {
+        vector<uint32_t> capacities, waitOffsets(1, 0), waiting;
+        for (size_t row = 0; row < courses.size(); ++row) {
+            const CourseSeats *s = seatsOf(courses[row].getCourseCode());
+            capacities.push_back(s ? s->capacity : 0);
+            if (s) {
+                for (const Waiter &w : s->waitlist)
+                    waiting.push_back(w.id);
+            }
+            waitOffsets.push_back(static_cast<uint32_t>(waiting.size()));
+        }
+        out.putArray(capacities);
+        out.putArray(waitOffsets);
+        out.putArray(waiting);
+    }
+
+    // The snapshot sections after putSeats(): student and course handles
+    // changed since the last export.
+    void putChanges(SnapshotWriter &out) const {
+        out.putArray(changedStudents.list());
+        out.putArray(changedCourses.list());
+    }
+
+    bool saveSnapshot() {
+        OpTimer timer(Op::SnapshotSave);
+        SnapshotWriter out;
+        putSnapshot(out);
+        putSeats(out);
+        putChanges(out);
+        if (withholdDamaged(messages, "Snapshot"))
+            return false;
+        uint64_t checksum;
+        string chunkSums;
+        string header = snapshotHeader(out.data(), chunkSums, checksum);
+
+        ensureDirectory(fs::path(kSnapshotFile).parent_path().string());
+        AtomicFileWriter file(exportBuffer);
+        if (!file.open(kSnapshotFile)) {
+            messages.write("Error opening file for snapshot.\n");
+            return false;
         }
-        // Write student info at the top of the file
-        file << "StudentID,Name,Type\n";
-        file << students[sIdx]->getID() << "," << students[sIdx]->getName() << "," << students[sIdx]->getType() << "\n\n";
-        file << "CourseCode,CourseName\n";
+        file.write(header);
+        file.write(out.data());
+        file.write(chunkSums);
+        if (!file.commit()) {
+            messages.write("Error writing snapshot.\n");
+            return false;
+        }
+        snapshotChecksum = checksum;
+        messages.write("Snapshot saved to ", kSnapshotFile, "\n");
+        return true;
+    }
 
-        const auto &courseCodes = students[sIdx]->getCourses();
-        for (const auto &code : courseCodes) {
-            int cIdx = findCourseIndex(code);
-            if (cIdx != -1) {
-                string line = courses[cIdx].getCourseCode() + "," + courses[cIdx].getCourseName();
-                cout << line << "\n";
-                file << line << "\n";
-            }
+    // True when the snapshot exists and neither CSV was written after it.
+    static bool snapshotIsCurrent() {
+        error_code ec;
+        if (!fs::exists(kSnapshotFile, ec))
+            return false;
+        auto snapshotTime = fs::last_write_time(kSnapshotFile, ec);
+        for (const char *csv : {"Students/students.csv", "Courses/courses.csv"}) {
+            string name = dataFileName(csv);
+            if (fs::exists(name, ec) && fs::last_write_time(name, ec) > snapshotTime)
+                return false;
         }
-        file.close();
-        cout << "Student report saved to: " << filename << "\n";
+        return !ec;
     }
 
-    // ----------------------------
-    // Data Export Functions
-    // ----------------------------
-    void exportStudentsToCSV() {
-        string dir = "Students";
-        ensureDirectory(dir);
-        string filename = dir + "/students.csv";
-        ofstream file(filename);
-        if (!file) {
-            cout << "Error opening file for exporting students.\n";
-            return;
+    // Load the snapshot into an empty model. Returns false (leaving the
+    // model untouched) if there is no current snapshot or it fails
+    // validation, in which case the caller falls back to the CSV loaders.
+    //
+    // With lazySnapshot() the file stays mapped: the ID tables, row
+    // columns, courses and seats are copied as usual, but student names
+    // and both enrollment sides are read in place (see
+    // StudentTable::assignMapped, EnrollmentGraph::assignMapped). Only
+    // the checksums of the copied sections are checked up front; each
+    // chunk of the rest is checked the first time it is read, and reads
+    // as missing if damaged (see SnapshotPages). Snapshots older than
+    // version 4 have no checksum table and are checked whole.
+    bool loadSnapshot() {
+        OpTimer timer(Op::SnapshotLoad);
+        if (students.size() != 0 || !courses.empty() || !snapshotIsCurrent())
+            return false;
+        const bool lazy = lazySnapshot();
+        auto pages = make_shared<SnapshotPages>(kSnapshotFile, !lazy);
+        const MappedFile &file = pages->mapping();
+        string_view data = file.isOpen() ? file.view() : string_view();
+        if (data.size() < kSnapshotHeaderSize || memcmp(data.data(), kSnapshotMagic, 8) != 0) {
+            messages.write("Snapshot ", kSnapshotFile, " is not valid; loading CSV files instead.\n");
+            return false;
         }
-        file << "StudentID,Name,Type,EnrolledCourses\n";
-        for (const auto &student : students) {
-            file << student->getID() << ","
-                 << student->getName() << ","
-                 << student->getType() << ",";
-            // Concatenate enrolled courses (separated by ;)
-            const auto &coursesList = student->getCourses();
-            for (size_t i = 0; i < coursesList.size(); ++i) {
-                file << coursesList[i];
-                if (i != coursesList.size() - 1)
-                    file << ";";
+        SnapshotReader header(data.substr(8, kSnapshotHeaderSize - 8));
+        uint32_t version = header.get<uint32_t>();
+        header.get<uint32_t>(); // flags
+        uint64_t payloadSize = header.get<uint64_t>();
+        uint64_t checksum = header.get<uint64_t>();
+        string_view payload = data.substr(kSnapshotHeaderSize);
+        string_view table;
+        if (version >= 4) {
+            size_t chunks = (payloadSize + SnapshotPages::kChunk - 1) / SnapshotPages::kChunk;
+            if (payloadSize <= payload.size() && payload.size() - payloadSize == chunks * 8) {
+                table = payload.substr(payloadSize);
+                payload = payload.substr(0, payloadSize);
             }
-            file << "\n";
         }
-        file.close();
-        cout << "Students exported to " << filename << "\n";
-    }
+        if (version < 1 || version > kSnapshotVersion || payloadSize != payload.size() ||
+            checksum64(version >= 4 ? table : payload) != checksum) {
+            messages.write("Snapshot ", kSnapshotFile, " is not valid; loading CSV files instead.\n");
+            return false;
+        }
+        pages->setChunks(payload, table);
 
-    void exportCoursesToCSV() {
-        string dir = "Courses";
-        ensureDirectory(dir);
-        string filename = dir + "/courses.csv";
-        ofstream file(filename);
-        if (!file) {
-            cout << "Error opening file for exporting courses.\n";
-            return;
+        SnapshotReader in(payload);
+        vector<uint64_t> studentIDOffsets, courseCodeOffsets, studentNameOffsets, courseNameOffsets;
+        vector<uint32_t> studentRowIDs, courseRowCodes;
+        vector<uint32_t> courseOffsets, courseEdges, studentOffsets, studentEdges;
+        vector<uint8_t> types;
+        in.getArray(studentIDOffsets);
+        string_view studentIDBlob = in.getBytes();
+        in.getArray(courseCodeOffsets);
+        string_view courseCodeBlob = in.getBytes();
+        in.getArray(studentRowIDs);
+        in.getArray(studentNameOffsets);
+        string_view studentNames = in.getBytes();
+        in.getArray(types);
+        in.getArray(courseRowCodes);
+        in.getArray(courseNameOffsets);
+        string_view courseNames = in.getBytes();
+        string_view courseOffsetBytes = in.getArrayBytes<uint32_t>();
+        string_view courseEdgeBytes = in.getArrayBytes<uint32_t>();
+        string_view studentOffsetBytes = in.getArrayBytes<uint32_t>();
+        string_view studentEdgeBytes = in.getArrayBytes<uint32_t>();
+        // Version 1 snapshots predate capacities: every course is unlimited.
+        vector<uint32_t> capacities(courseRowCodes.size(), 0), waitOffsets(courseRowCodes.size() + 1, 0), waiting;
+        if (version >= 2) {
+            in.getArray(capacities);
+            in.getArray(waitOffsets);
+            in.getArray(waiting);
+        }
+        // Before version 3 the CSVs are taken to be up to date.
+        vector<uint32_t> changedIDs, changedCodes;
+        if (version >= 3) {
+            in.getArray(changedIDs);
+            in.getArray(changedCodes);
+        }
+        auto copyOut = [](string_view bytes, vector<uint32_t> &values) {
+            values.resize(bytes.size() / sizeof(uint32_t));
+            memcpy(values.data(), bytes.data(), values.size() * sizeof(uint32_t));
+        };
+        // Everything but the lazily read sections is verified now; those
+        // are laid out in this order, so the rest is the gaps between them.
+        auto copiedIntact = [&] {
+            if (!lazy)
+                return pages->verify(payload.data(), payload.size(), false);
+            const char *from = payload.data();
+            for (string_view lazyPart : {studentNames, courseOffsetBytes, courseEdgeBytes, studentOffsetBytes,
+                                         studentEdgeBytes}) {
+                if (lazyPart.data() < from || !pages->verify(from, static_cast<size_t>(lazyPart.data() - from), false))
+                    return false;
+                from = lazyPart.data() + lazyPart.size();
+            }
+            return pages->verify(from, static_cast<size_t>(payload.data() + payload.size() - from), false);
+        };
+        if (!in.good() || !copiedIntact()) {
+            messages.write("Snapshot ", kSnapshotFile, " is not valid; loading CSV files instead.\n");
+            return false;
+        }
+        if (!lazy) {
+            copyOut(courseOffsetBytes, courseOffsets);
+            copyOut(courseEdgeBytes, courseEdges);
+            copyOut(studentOffsetBytes, studentOffsets);
+            copyOut(studentEdgeBytes, studentEdges);
+        }
+
+        // Structural checks so a damaged-but-checksummed file cannot index
+        // out of bounds below.
+        auto offsetsFit = [](const vector<uint64_t> &offsets, size_t count, size_t blobSize) {
+            if (offsets.size() != count + 1 || offsets[0] != 0 || offsets.back() != blobSize)
+                return false;
+            return is_sorted(offsets.begin(), offsets.end());
+        };
+        auto csrFits = [](const vector<uint32_t> &offsets, const vector<uint32_t> &edges,
+                          size_t count, size_t limit) {
+            if (offsets.size() != count + 1 || offsets[0] != 0 || offsets.back() != edges.size() ||
+                !is_sorted(offsets.begin(), offsets.end()))
+                return false;
+            return all_of(edges.begin(), edges.end(), [&](uint32_t h) { return h < limit; });
+        };
+        size_t studentAtoms = in.good() && !studentIDOffsets.empty() ? studentIDOffsets.size() - 1 : 0;
+        size_t courseAtoms = in.good() && !courseCodeOffsets.empty() ? courseCodeOffsets.size() - 1 : 0;
+        // A lazy load only checks the enrollment arrays' sizes.
+        bool enrollmentFits = lazy
+            ? courseOffsetBytes.size() == (studentAtoms + 1) * 4 && studentOffsetBytes.size() == (courseAtoms + 1) * 4 &&
+                  courseEdgeBytes.size() == studentEdgeBytes.size() && studentNames.size() <= numeric_limits<uint32_t>::max()
+            : csrFits(courseOffsets, courseEdges, studentAtoms, courseAtoms) &&
+                  csrFits(studentOffsets, studentEdges, courseAtoms, studentAtoms) &&
+                  courseEdges.size() == studentEdges.size();
+        bool valid = in.good() && in.atEnd() &&
+            offsetsFit(studentIDOffsets, studentAtoms, studentIDBlob.size()) &&
+            offsetsFit(courseCodeOffsets, courseAtoms, courseCodeBlob.size()) &&
+            offsetsFit(studentNameOffsets, studentRowIDs.size(), studentNames.size()) &&
+            offsetsFit(courseNameOffsets, courseRowCodes.size(), courseNames.size()) &&
+            types.size() == studentRowIDs.size() &&
+            all_of(types.begin(), types.end(), [](uint8_t t) { return t <= 1; }) &&
+            all_of(studentRowIDs.begin(), studentRowIDs.end(), [&](uint32_t h) { return h < studentAtoms; }) &&
+            all_of(courseRowCodes.begin(), courseRowCodes.end(), [&](uint32_t h) { return h < courseAtoms; }) &&
+            enrollmentFits &&
+            capacities.size() == courseRowCodes.size() &&
+            csrFits(waitOffsets, waiting, courseRowCodes.size(), studentAtoms) &&
+            all_of(changedIDs.begin(), changedIDs.end(), [&](uint32_t h) { return h < studentAtoms; }) &&
+            all_of(changedCodes.begin(), changedCodes.end(), [&](uint32_t h) { return h < courseAtoms; });
+        if (!valid) {
+            messages.write("Snapshot ", kSnapshotFile, " is not valid; loading CSV files instead.\n");
+            return false;
+        }
+
+        // Interning into the empty tables in stored order hands back the
+        // stored handles, so the columns and CSR arrays can be used as-is.
+        for (size_t h = 0; h < studentAtoms; ++h)
+            studentIDs.intern(studentIDBlob.substr(studentIDOffsets[h], studentIDOffsets[h + 1] - studentIDOffsets[h]));
+        for (size_t h = 0; h < courseAtoms; ++h)
+            internCourseCode(courseCodeBlob.substr(courseCodeOffsets[h], courseCodeOffsets[h + 1] - courseCodeOffsets[h]));
+        if (lazy) {
+            // The same rows insertStudentRecord would build, with the
+            // names left in the file.
+            size_t rows = studentRowIDs.size();
+            vector<uint64_t> nameOffsets(studentNameOffsets.begin(), studentNameOffsets.end() - 1);
+            vector<uint32_t> nameLengths(rows);
+            vector<StudentType> rowTypes(rows);
+            studentIndex.clear();
+            studentIndex.resize(studentAtoms, kNoSlot);
+            SlotIndex::Editor slots(studentIndex);
+            for (size_t row = 0; row < rows; ++row) {
+                nameLengths[row] = static_cast<uint32_t>(studentNameOffsets[row + 1] - studentNameOffsets[row]);
+                rowTypes[row] = static_cast<StudentType>(types[row]);
+                slots[studentRowIDs[row]] = static_cast<uint32_t>(row);
+            }
+            students.assignMapped(*pages, studentNames, studentRowIDs, nameOffsets, nameLengths, rowTypes);
+        } else {
+            for (size_t row = 0; row < studentRowIDs.size(); ++row) {
+                uint32_t id = studentRowIDs[row];
+                insertStudentRecord(studentIDs.str(id),
+                                    studentNames.substr(studentNameOffsets[row], studentNameOffsets[row + 1] - studentNameOffsets[row]),
+                                    static_cast<StudentType>(types[row]));
+            }
         }
-        file << "CourseCode,CourseName,EnrolledStudents\n";
-        for (const auto &course : courses) {
-            file << course.getCourseCode() << ","
-                 << course.getCourseName() << ",";
-            const auto &studentsList = course.getEnrolledStudents();
-            for (size_t i = 0; i < studentsList.size(); ++i) {
-                file << studentsList[i];
-                if (i != studentsList.size() - 1)
-                    file << ";";
+        for (size_t row = 0; row < courseRowCodes.size(); ++row) {
+            insertCourseRecord(courseNames.substr(courseNameOffsets[row], courseNameOffsets[row + 1] - courseNameOffsets[row]),
+                               courseRowCodes[row]);
+        }
+        if (lazy) {
+            enrollment.assignMapped(*pages, courseOffsetBytes, courseEdgeBytes, studentOffsetBytes, studentEdgeBytes,
+                                    studentAtoms, courseAtoms);
+            snapshotPages = pages;
+        } else {
+            enrollment.assign(courseOffsets, courseEdges, studentOffsets, studentEdges);
+        }
+        for (size_t row = 0; row < courseRowCodes.size(); ++row) {
+            if (capacities[row] == 0 && waitOffsets[row] == waitOffsets[row + 1])
+                continue;
+            CourseSeats &s = seatsFor(courseRowCodes[row]);
+            s.capacity = capacities[row];
+            for (uint32_t i = waitOffsets[row]; i < waitOffsets[row + 1]; ++i) {
+                uint32_t id = waiting[i];
+                if (id < studentIndex.size() && studentIndex[id] != kNoSlot)
+                    addWaiter(s, id, nextTicket++);
             }
-            file << "\n";
         }
-        file.close();
-        cout << "Courses exported to " << filename << "\n";
+        changedStudents.take();
+        changedCourses.take();
+        for (uint32_t id : changedIDs)
+            changedStudents.mark(id);
+        for (uint32_t code : changedCodes)
+            changedCourses.mark(code);
+        snapshotChecksum = checksum;
+        return true;
     }
-    
+
     // ----------------------------
-    // Data Loading Functions (Persistence)
+    // Write-Ahead Log Functions
     // ----------------------------
-    // Load students from CSV file
-    void loadStudentsFromCSV() {
-        string filename = "Students/students.csv";
-        ifstream file(filename);
-        if (!file) {
-            // File may not exist on first run
-            return;
-        }
-        string line;
-        getline(file, line); // Skip header
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            stringstream ss(line);
-            string studentID, name, type, coursesStr;
-            getline(ss, studentID, ',');
-            getline(ss, name, ',');
-            getline(ss, type, ',');
-            getline(ss, coursesStr);
-            
-            addStudent(name, studentID, type); // addStudent() already checks for duplicates
+    static constexpr const char *kLogFile = "Snapshots/sms.wal";
+    static constexpr uint64_t kLogCompactBytes = 64ull << 20;
 
-            // Split coursesStr by ';' and add them
-            if (!coursesStr.empty()) {
-                stringstream courseStream(coursesStr);
-                string courseCode;
-                while (getline(courseStream, courseCode, ';')) {
-                    int sIdx = findStudentIndex(studentID);
-                    if (sIdx != -1)
-                        students[sIdx]->addCourse(courseCode);
-                }
-            }
+    // Replay any log left on top of the state just loaded, then keep
+    // appending to it. Call once, after loadSnapshot()/loadData().
+    void openLog() {
+        ensureDirectory(fs::path(kLogFile).parent_path().string());
+        OperationLog::recover(kLogFile, snapshotChecksum);
+        uint64_t keep;
+        {
+            OpTimer timer(Op::LogReplay);
+            keep = OperationLog::replay(kLogFile, snapshotChecksum,
+                [this](LogOp op, const vector<string_view> &f) { replayOperation(op, f); });
         }
-        file.close();
+        if (!oplog.open(kLogFile, snapshotChecksum, keep))
+            cout << "Warning: could not open operation log " << kLogFile << "\n";
+    }
+
+    // Make every logged operation durable; called once per user command.
+    // Returns false if the log could not be written; it then records
+    // nothing until the next checkpoint.
+    bool commitLog() { return finishLogCommit(startLogCommit()); }
+
+    // commitLog() in two halves for a model shared between threads:
+    // startLogCommit() with writers excluded, then finishLogCommit() with
+    // the ticket after letting them go, so they never wait for the fsync.
+    uint64_t startLogCommit() { return oplog.seal(); }
+
+    bool finishLogCommit(uint64_t ticket) {
+        OpTimer timer(Op::LogCommit);
+        if (oplog.flush(ticket))
+            return true;
+        cout << "Warning: could not write operation log " << kLogFile
+             << "; changes are not logged until the next checkpoint\n";
+        return false;
     }
 
-    // Load courses from CSV file
-    void loadCoursesFromCSV() {
-        string filename = "Courses/courses.csv";
-        ifstream file(filename);
-        if (!file) {
-            // File may not exist on first run
+    // Fold the log into a fresh snapshot and start an empty log on top of
+    // it. This is also what brings a failed log back.
+    void checkpoint() {
+        OpTimer timer(Op::Checkpoint);
+        bool wasActive = oplog.isActive() || oplog.hasFailed();
+        oplog.commit();
+        if (saveSnapshot() && wasActive)
+            oplog.open(kLogFile, snapshotChecksum);
+    }
+
+    // checkpoint() for a model shared between threads, with the snapshot
+    // written while writers carry on. beginCheckpoint() takes a pinned
+    // version and marks the log, with writers excluded; writeCheckpoint()
+    // writes the version's snapshot to a temp file, holding nothing; and
+    // endCheckpoint(), with writers excluded again, renames it into place
+    // and rebases the log onto it, keeping the records logged since the
+    // mark. If any step fails, or the log was reopened meanwhile,
+    // endCheckpoint() does a full checkpoint() instead.
+    struct PendingCheckpoint {
+        shared_ptr<const ModelData> version;
+        SnapshotWriter sections; // putSeats() and putChanges() at the pin
+        OperationLog::Mark logMark;
+        uint64_t checksum = 0;
+        string buffer;
+        unique_ptr<AtomicFileWriter> file;
+    };
+
+    void beginCheckpoint(PendingCheckpoint &cp, shared_ptr<const ModelData> version) {
+        cp.version = move(version);
+        putSeats(cp.sections);
+        putChanges(cp.sections);
+        cp.logMark = oplog.mark();
+    }
+
+    // Leaves cp.file unset, so endCheckpoint() falls back to checkpoint(),
+    // if the write fails or the version is damaged (which the fallback
+    // then reports).
+    static void writeCheckpoint(PendingCheckpoint &cp) {
+        OpTimer timer(Op::SnapshotSave);
+        SnapshotWriter out;
+        cp.version->putSnapshot(out);
+        out.append(cp.sections);
+        if (cp.version->snapshotDamaged())
             return;
+        string chunkSums;
+        string header = snapshotHeader(out.data(), chunkSums, cp.checksum);
+        ensureDirectory(fs::path(kSnapshotFile).parent_path().string());
+        // Not the ".tmp" of saveSnapshot(), which a writer may run meanwhile.
+        cp.file = make_unique<AtomicFileWriter>(cp.buffer);
+        if (cp.file->open(kSnapshotFile, false, ".next")) {
+            cp.file->write(header);
+            cp.file->write(out.data());
+            cp.file->write(chunkSums);
         }
-        string line;
-        getline(file, line); // Skip header
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            stringstream ss(line);
-            string courseCode, courseName, studentsStr;
-            getline(ss, courseCode, ',');
-            getline(ss, courseName, ',');
-            getline(ss, studentsStr);
+        if (!cp.file->sync())
+            cp.file.reset();
+    }
 
-            addCourse(courseName, courseCode);
+    void endCheckpoint(PendingCheckpoint &cp) {
+        cp.version.reset();
+        bool wasActive = oplog.isActive() || oplog.hasFailed();
+        bool done = cp.file && (!wasActive || oplog.prepareRebase(cp.logMark, cp.checksum)) &&
+                    cp.file->replace();
+        cp.file.reset();
+        if (done) {
+            snapshotChecksum = cp.checksum;
+            messages.write("Snapshot saved to ", kSnapshotFile, "\n");
+            done = !wasActive || oplog.finishRebase(cp.checksum);
+        }
+        if (!done)
+            checkpoint();
+    }
 
-            // Split studentsStr by ';' and add them
-            if (!studentsStr.empty()) {
-                stringstream stuStream(studentsStr);
-                string stuID;
-                while (getline(stuStream, stuID, ';')) {
-                    int cIdx = findCourseIndex(courseCode);
-                    if (cIdx != -1)
-                        courses[cIdx].addStudent(stuID);
+    // Apply one logged operation. Every record was a mutation that
+    // succeeded on the state the log extends, so the checks here only
+    // guard against a log that does not belong to it.
+    void replayOperation(LogOp op, const vector<string_view> &f) {
+        auto field = [&](size_t i) { return i < f.size() ? f[i] : string_view(); };
+        switch (op) {
+            case LogOp::AddStudent: {
+                StudentType type;
+                if (findStudentIndex(field(0)) == -1 && parseStudentType(field(2), type))
+                    applyAddStudent(field(0), field(1), type);
+                break;
+            }
+            case LogOp::RemoveStudent: {
+                int sIdx = findStudentIndex(field(0));
+                if (sIdx != -1)
+                    applyRemoveStudent(sIdx);
+                break;
+            }
+            case LogOp::AddCourse:
+                if (findCourseIndex(field(0)) == -1)
+                    applyAddCourse(field(1), courseCodes.intern(field(0)));
+                break;
+            case LogOp::RemoveCourse: {
+                int cIdx = findCourseIndex(field(0));
+                if (cIdx != -1)
+                    applyRemoveCourse(cIdx);
+                break;
+            }
+            case LogOp::Enroll:
+            case LogOp::RemoveFromCourse: {
+                int sIdx = findStudentIndex(field(0));
+                int cIdx = findCourseIndex(field(1));
+                if (sIdx == -1 || cIdx == -1)
+                    break;
+                uint32_t id = students.id(sIdx), code = courses[cIdx].getCourseCode();
+                CourseSeats *s = seatsOf(code);
+                // Promotions are logged as enrolls, so the waitlists are
+                // only ever shortened here. An unenroll that unlinks
+                // nothing was a student leaving the waitlist.
+                if (op == LogOp::Enroll) {
+                    if (s)
+                        removeWaiter(*s, id);
+                    if (enrollment.link(id, code))
+                        markChanged(id, code);
+                } else if (enrollment.unlink(id, code)) {
+                    markChanged(id, code);
+                } else if (s) {
+                    removeWaiter(*s, id);
+                }
+                break;
+            }
+            case LogOp::EnrollBatch: {
+                vector<pair<uint32_t, uint32_t>> edges;
+                for (size_t i = 0; i + 1 < f.size(); i += 2) {
+                    int sIdx = findStudentIndex(f[i]);
+                    int cIdx = findCourseIndex(f[i + 1]);
+                    if (sIdx != -1 && cIdx != -1)
+                        edges.emplace_back(students.id(sIdx), courses[cIdx].getCourseCode());
                 }
+                enrollment.linkAll(edges);
+                for (const auto &e : edges)
+                    markChanged(e.first, e.second);
+                break;
+            }
+            case LogOp::SetCapacity: {
+                int cIdx = findCourseIndex(field(0));
+                if (cIdx != -1)
+                    seatsFor(courses[cIdx].getCourseCode()).capacity =
+                        uint32_t(strtoul(string(field(1)).c_str(), nullptr, 10));
+                break;
             }
+            case LogOp::Waitlist: {
+                int sIdx = findStudentIndex(field(0));
+                int cIdx = findCourseIndex(field(1));
+                if (sIdx == -1 || cIdx == -1)
+                    break;
+                uint32_t id = students.id(sIdx), code = courses[cIdx].getCourseCode();
+                CourseSeats &s = seatsFor(code);
+                if (!enrollment.contains(id, code) && !isWaiting(s, id))
+                    addWaiter(s, id, nextTicket++);
+                break;
+            }
+            case LogOp::ChangesExported:
+                takeChanges();
+                break;
         }
-        file.close();
-    }
-
-    // Wrapper function to load both students and courses.
-    void loadData() {
-        loadStudentsFromCSV();
-        loadCoursesFromCSV();
     }
 
     // ----------------------------
@@ -625,17 +6109,836 @@ public:
         enrollStudentInCourse("S005", "CSE102");
         enrollStudentInCourse("S005", "CSE104");
         
-        cout << "\nDummy data populated successfully.\n";
+        messages.write("\nDummy data populated successfully.\n");
+    }
+
+    // Generate a large synthetic dataset: students S0000000, S0000001, ...
+    // (at least seven digits, more if the count needs them) and courses
+    // C00000, C00001, ..., each student enrolled in distinct random courses.
+    // Students are generated in fixed-size blocks on a thread pool, each
+    // block from its own generator seeded by (seed, block number), so the
+    // data only depends on the spec and never on the thread count. Only
+    // an empty model is filled, so every ID and enrollment is new: blocks
+    // are merged in order, students appended directly and all the
+    // enrollments linked through one EnrollmentGraph::linkAll. Returns
+    // InvalidArgument for a model that has data, or for students with no
+    // courses to enroll in. Nothing is logged, so the caller should
+    // checkpoint() afterwards.
+    Status generateDummyData(const DummyDataSpec &spec, size_t threads = ThreadPool::defaultThreads()) {
+        OpTimer timer(Op::Generate);
+        static const char *const firstNames[] = {"Alice", "Bob", "Charlie", "David", "Eve", "Fatima",
+                                                 "George", "Hana", "Ivan", "Julia", "Kenji", "Laila",
+                                                 "Mohamed", "Nora", "Omar", "Priya"};
+        static const char *const lastNames[] = {"Johnson", "Smith", "Brown", "Williams", "Davis", "Aziz",
+                                                "Garcia", "Chen", "Khan", "Martin", "Nguyen", "Okafor",
+                                                "Park", "Rossi", "Silva", "Tanaka"};
+        const size_t kBlock = 1 << 15, kMaxNameBytes = 16;
+        if (students.size() != 0 || !courses.empty()) {
+            messages.write("Dummy data can only be generated into an empty model.\n");
+            return Status::InvalidArgument;
+        }
+        if (spec.students && !spec.courses) {
+            messages.write("Generated students need at least one course to enroll in.\n");
+            return Status::InvalidArgument;
+        }
+        MessageScope quiet(messages, MessageMode::None);
+        courseReports.clear();
+        studentReports.clear();
+
+        auto padded = [](char prefix, size_t value, size_t width, string &out) {
+            char digits[24];
+            int len = snprintf(digits, sizeof(digits), "%0*zu", int(width), value);
+            out.push_back(prefix);
+            out.append(digits, size_t(len));
+        };
+        auto widthFor = [](size_t count, size_t minWidth) {
+            size_t width = 1;
+            for (size_t n = count > 0 ? count - 1 : 0; n >= 10; n /= 10)
+                ++width;
+            return max(width, minWidth);
+        };
+        const size_t idWidth = widthFor(spec.students, 7), codeWidth = widthFor(spec.courses, 5);
+
+        vector<uint32_t> courseHandles(spec.courses);
+        {
+            CsvBatch batch;
+            vector<string> codes(spec.courses), names(spec.courses);
+            for (size_t i = 0; i < spec.courses; ++i) {
+                padded('C', i, codeWidth, codes[i]);
+                names[i] = "Course " + to_string(i);
+                batch.rows.push_back({codes[i], names[i], string_view()});
+            }
+            applyCourseRows(batch);
+            for (size_t i = 0; i < spec.courses; ++i)
+                courseHandles[i] = courseCodes.find(codes[i]);
+        }
+
+        const size_t perStudent = size_t(spec.enrollmentsPerStudent);
+        const double extraChance = spec.enrollmentsPerStudent - double(perStudent);
+        // Row refs index picks, which holds course numbers.
+        struct Block {
+            string text; // IDs and names; reserved up front so the views stay valid
+            vector<CsvRow> rows;
+            vector<uint32_t> picks;
+        };
+        auto generate = [&](size_t blockNo, Block &block) {
+            SplitMix64 rng(spec.seed ^ (0xD1B54A32D192ED03ull * (blockNo + 1)));
+            size_t first = blockNo * kBlock, last = min(spec.students, first + kBlock);
+            block.text.clear();
+            block.text.reserve((last - first) * (1 + idWidth + 2 * kMaxNameBytes));
+            block.rows.clear();
+            block.picks.clear();
+            for (size_t i = first; i < last; ++i) {
+                CsvRow row;
+                size_t start = block.text.size();
+                padded('S', i, idWidth, block.text);
+                row.key = string_view(block.text).substr(start);
+                start = block.text.size();
+                block.text.append(firstNames[rng.below(size(firstNames))]).push_back(' ');
+                block.text.append(lastNames[rng.below(size(lastNames))]);
+                row.name = string_view(block.text).substr(start);
+                row.type = rng.below(4) ? "Undergraduate" : "Postgraduate";
+
+                size_t count = perStudent + (rng.unit() < extraChance ? 1 : 0);
+                count = min(count, spec.courses);
+                row.firstRef = block.picks.size();
+                row.refCount = count;
+                while (block.picks.size() - row.firstRef < count) {
+                    uint32_t course = uint32_t(rng.below(spec.courses));
+                    if (find(block.picks.begin() + row.firstRef, block.picks.end(), course) == block.picks.end())
+                        block.picks.push_back(course);
+                }
+                block.rows.push_back(row);
+            }
+        };
+
+        // A few blocks per thread are generated while memory stays bounded,
+        // then merged on this thread in block order.
+        const size_t blocks = (spec.students + kBlock - 1) / kBlock;
+        const size_t wave = max<size_t>(1, threads) * 2;
+        vector<Block> staged(min(blocks, wave));
+        vector<pair<uint32_t, uint32_t>> edges;
+        ThreadPool pool(threads);
+        for (size_t base = 0; base < blocks; base += wave) {
+            size_t count = min(wave, blocks - base);
+            for (size_t i = 0; i < count; ++i)
+                pool.submit([&, i] { generate(base + i, staged[i]); });
+            pool.wait();
+            for (size_t i = 0; i < count; ++i) {
+                for (const CsvRow &row : staged[i].rows) {
+                    StudentType type = StudentType::Undergraduate;
+                    parseStudentType(row.type, type);
+                    uint32_t id = insertStudentRecord(row.key, row.name, type);
+                    for (size_t k = 0; k < row.refCount; ++k)
+                        edges.emplace_back(id, courseHandles[staged[i].picks[row.firstRef + k]]);
+                }
+            }
+        }
+        // One linkAll for everything, so each list and the edge index are
+        // sized once instead of once per wave.
+        enrollment.linkAll(edges);
+        for (const auto &e : edges)
+            markChanged(e.first, e.second);
+        return Status::Ok;
+    }
+};
+
+// Format the page a "list-students [id|name|type] [limit] [cursor]" or
+// "list-courses [code|name] [limit] [cursor]" request asks for, followed by
+// a "Next cursor: ..." line unless it is the last page. Returns false for
+// bad arguments or a bad cursor.
+bool formatListRequest(StudentManagement &sms, const vector<string_view> &f, string &out) {
+    const size_t kDefaultLimit = 50;
+    bool courses = f[0] == "list-courses";
+    ListOrder order = ListOrder::Id;
+    size_t limit = kDefaultLimit;
+    if (f.size() > 4 || (f.size() > 1 && !parseListOrder(f[1], courses, order)))
+        return false;
+    if (f.size() > 2) {
+        string text(f[2]);
+        char *end;
+        limit = size_t(strtoull(text.c_str(), &end, 10));
+        if (text.empty() || *end != '\0' || limit == 0)
+            return false;
+    }
+    string_view cursor = f.size() > 3 ? f[3] : string_view();
+    string next;
+    bool ok = courses ? sms.formatCoursePage(out, next, order, limit, cursor)
+                      : sms.formatStudentPage(out, next, order, limit, cursor);
+    if (ok && !next.empty())
+        out.append("Next cursor: ").append(next).push_back('\n');
+    return ok;
+}
+
+// A whole number of at most nine digits, such as a capacity or a top-N.
+bool parseCount(string_view text, uint32_t &value) {
+    if (text.empty() || text.size() > 9 || !all_of(text.begin(), text.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); }))
+        return false;
+    value = uint32_t(stoul(string(text)));
+    return true;
+}
+
+// Summarise a batch enrollment, listing at most `limit` rejected rows.
+void printEnrollReport(const EnrollBatchReport &report, size_t limit = 10) {
+    cout << "Enrolled " << report.enrolled << " of " << report.rows << " rows";
+    if (!report.errors.empty())
+        cout << "; " << report.errors.size() << " rejected";
+    cout << ".\n";
+    for (size_t i = 0; i < report.errors.size() && i < limit; ++i)
+        cout << "  line " << report.errors[i].row << ": " << enrollErrorName(report.errors[i].reason) << "\n";
+    if (report.errors.size() > limit)
+        cout << "  ... and " << report.errors.size() - limit << " more\n";
+}
+
+// ----------------------------
+// Command Line Mode
+// ----------------------------
+// Every operation is one command name plus its fields, given either as
+// program arguments or as one comma-separated line of a script file:
+//   sms enroll S001 CSE101
+//   sms script nightly.txt      (lines like "enroll,S001,CSE101")
+// Status messages go to stdout unless --quiet is given. Changes are made
+// durable through the operation log like menu commands.
+void printUsage() {
+    cout << "Usage: sms [--arena] [--compress] [--lazy] [--metrics[=file]] [--id-digits=[min-]max] [--quiet]\n"
+            "           <command> [fields...]\n"
+            "Commands:\n"
+            "  import <students.csv> [courses.csv]  merge CSV files into the data\n"
+            "  enroll-batch <file>                  enroll studentID,courseCode rows\n"
+            "  export                               write Students/ and Courses/ CSVs\n"
+            "  export-delta                         write only what changed since the last export\n"
+            "                                       to Changes/, or consolidate into a full export\n"
+            "  report-all                           write every course and student report\n"
+            "  analytics [top-n]                    enrollment counts, courses per student, type\n"
+            "                                       split, top courses and course pairs (default 10)\n"
+            "  script <file|->                      run one command per line, fields split by ','\n"
+            "  serve <port> [address]               answer requests over TCP (default 127.0.0.1)\n"
+            "  add-student <id> <name> <type>    remove-student <id>\n"
+            "  add-course <code> <name>          remove-course <code>\n"
+            "  enroll <id> <code>                unenroll <id> <code>\n"
+            "  report-course <code>              report-student <id>\n"
+            "  set-capacity <code> <seats>       seats <code>\n"
+            "                                       limit a course (0 = unlimited); enrolls past\n"
+            "                                       the limit join a waitlist promoted in order\n"
+            "  list-students [id|name|type] [limit] [cursor]\n"
+            "  list-courses [code|name] [limit] [cursor]\n"
+            "                                       one sorted page (default 50 rows); pass the\n"
+            "                                       printed cursor to get the next page\n"
+            "  populate-dummy [students courses [per-student [seed]]]\n"
+            "                                       sample data, or a dataset generated into an empty model\n"
+            "  metrics\n"
+            "--compress writes exports, change files and reports as LZ4 (<name>.lz4);\n"
+            "loading reads either form.\n"
+            "--lazy maps the snapshot and reads names and enrollments from it on first use.\n"
+            "--metrics records operation latencies and writes them in Prometheus text\n"
+            "format to the file (or stdout) on exit; metrics prints them on demand.\n";
+}
+
+// Run one operation. Returns false for an unknown command or wrong field count.
+bool runOperation(StudentManagement &sms, const vector<string_view> &f, Status &status) {
+    auto arg = [&](size_t i) { return i < f.size() ? string(f[i]) : string(); };
+    string_view cmd = f.empty() ? string_view() : f[0];
+    size_t n = f.size() - 1;
+    status = Status::Ok;
+    if (cmd == "add-student" && n == 3)         status = sms.addStudent(arg(2), arg(1), arg(3));
+    else if (cmd == "remove-student" && n == 1) status = sms.removeStudent(arg(1));
+    else if (cmd == "add-course" && n == 2)     status = sms.addCourse(arg(2), arg(1));
+    else if (cmd == "remove-course" && n == 1)  status = sms.removeCourse(arg(1));
+    else if (cmd == "enroll" && n == 2)         status = sms.enrollStudentInCourse(arg(1), arg(2));
+    else if (cmd == "unenroll" && n == 2)       status = sms.removeStudentFromCourse(arg(1), arg(2));
+    else if (cmd == "set-capacity" && n == 2) {
+        uint32_t capacity;
+        if (!parseCount(f[2], capacity))
+            return false;
+        status = sms.setCourseCapacity(arg(1), capacity);
+    }
+    else if (cmd == "seats" && n == 1) {
+        string out;
+        if (!sms.formatCourseSeats(out, f[1])) {
+            sms.messageSink().write("Course with code ", f[1], " not found.\n");
+            status = Status::CourseNotFound;
+        }
+        cout << out;
+    }
+    else if (cmd == "report-course" && n == 1)  sms.generateReportForCourse(arg(1));
+    else if (cmd == "report-student" && n == 1) sms.generateReportForStudent(arg(1));
+    else if (cmd == "report-all" && n == 0)     status = sms.generateAllReports();
+    else if (cmd == "analytics" && n <= 1) {
+        uint32_t topN = 10;
+        if (n == 1 && !parseCount(f[1], topN))
+            return false;
+        status = sms.generateAnalyticsReport(topN);
+    }
+    else if (cmd == "populate-dummy" && n == 0) sms.populateDummyData();
+    else if (cmd == "populate-dummy" && n >= 2 && n <= 4) {
+        DummyDataSpec spec;
+        char *end;
+        bool ok = true;
+        auto number = [&](size_t i, auto parse) {
+            string text = arg(i);
+            auto value = parse(text.c_str(), &end);
+            ok = ok && !text.empty() && *end == '\0';
+            return value;
+        };
+        spec.students = number(1, [](const char *s, char **e) { return size_t(strtoull(s, e, 10)); });
+        spec.courses = number(2, [](const char *s, char **e) { return size_t(strtoull(s, e, 10)); });
+        if (n >= 3)
+            spec.enrollmentsPerStudent = number(3, [](const char *s, char **e) { return strtod(s, e); });
+        if (n >= 4)
+            spec.seed = number(4, [](const char *s, char **e) { return uint64_t(strtoull(s, e, 10)); });
+        if (!ok || spec.enrollmentsPerStudent < 0)
+            return false;
+        status = sms.generateDummyData(spec);
+        if (status == Status::Ok) {
+            sms.messageSink().write("Generated ", spec.students, " students and ", spec.courses, " courses.\n");
+            sms.checkpoint();
+        }
+    }
+    else if (cmd == "metrics" && n == 0)        cout << Metrics::prometheusText();
+    else if (cmd == "list-students" || cmd == "list-courses") {
+        string page;
+        if (!formatListRequest(sms, f, page))
+            return false;
+        cout << page;
+    }
+    else if (cmd == "export" && n == 0) {
+        status = sms.exportDataParallel();
+        sms.checkpoint();
+    } else if (cmd == "export-delta" && n == 0) {
+        status = sms.exportDelta();
+    } else if (cmd == "import" && (n == 1 || n == 2)) {
+        status = sms.importCSV(arg(1), arg(2));
+        if (status != Status::Ok)
+            cout << "Could not read " << arg(1) << (n == 2 ? " or " + arg(2) : string()) << ".\n";
+        sms.checkpoint();
+    } else if (cmd == "enroll-batch" && n == 1) {
+        EnrollBatchReport report;
+        if (!sms.enrollBatchFromCSV(arg(1), report)) {
+            cout << "Could not open " << arg(1) << ".\n";
+            status = Status::IoError;
+        } else {
+            printEnrollReport(report);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Run a script held in memory. Blank lines and lines starting with '#' are
+// skipped. Returns the number of failed lines.
+size_t runScript(StudentManagement &sms, string_view text) {
+    vector<string_view> fields;
+    string_view line;
+    size_t lineNo = 0, failed = 0;
+    while (nextLine(text, line)) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty() || line[0] == '#')
+            continue;
+        fields.clear();
+        while (!line.empty())
+            fields.push_back(nextField(line, ','));
+        Status status;
+        if (!runOperation(sms, fields, status)) {
+            cout << "line " << lineNo << ": unknown command or wrong number of fields\n";
+            failed++;
+        } else if (status != Status::Ok) {
+            cout << "line " << lineNo << ": " << statusName(status) << "\n";
+            failed++;
+        }
+    }
+    return failed;
+}
+
+// ----------------------------
+// Server Mode
+// ----------------------------
+// Line protocol over TCP: each request is one line in the script syntax
+// ("enroll,S001,CSE101"); each response is "OK <n>\n" or "ERR <n>\n"
+// followed by n bytes of payload (the status message, search result lines
+// or report body). Requests on one connection are answered in order.
+//
+// Every worker thread runs its own epoll loop and accepts from the shared
+// listening socket, so connections are spread across workers without a
+// hand-off. Reads (search, report-*) run under a shared lock and proceed in
+// parallel; writes take the lock exclusively, and the operation log is
+// committed once per batch of requests before any of its replies go out.
+// export and report-all pin a model version under the shared lock and then
+// write from it unlocked, so writers are only held up while it is pinned.
+// The snapshot that follows an export is written from the same version;
+// the lock is taken again only to rename it in and move the log onto it.
+#if SMS_EPOLL
+class StudentServer {
+private:
+    static constexpr size_t kMaxRequestBytes = 1 << 20;
+
+    struct Connection {
+        int fd;
+        string in;
+        string out;
+        size_t sent = 0;
+        bool closing = false;
+    };
+
+    StudentManagement &sms;
+    shared_mutex modelLock;
+    mutex exportLock; // one export/report-all at a time: they share file names
+    int listenFd = -1;
+
+    static atomic<bool> &stopFlag() {
+        static atomic<bool> flag{false};
+        return flag;
+    }
+
+    static void onSignal(int) { stopFlag() = true; }
+
+    static void appendReply(string &out, bool ok, string_view payload) {
+        out.append(ok ? "OK " : "ERR ").append(to_string(payload.size())).push_back('\n');
+        out.append(payload);
+    }
+
+    // One request's reply. A reply to a write is marked logged and held
+    // back until the log records it made are durable (see handleInput).
+    struct Reply {
+        bool ok;
+        string payload;
+        bool logged = false;
+    };
+
+    // Run one request line and return its reply.
+    Reply handleRequest(string_view line, bool &quit) {
+        vector<string_view> f;
+        while (!line.empty())
+            f.push_back(nextField(line, ','));
+        string_view cmd = f.empty() ? string_view() : f[0];
+        size_t n = f.empty() ? 0 : f.size() - 1;
+        auto arg = [&](size_t i) { return string(f[i]); };
+
+        if (cmd == "search" || cmd == "search-i" || cmd == "report-course" || cmd == "report-student" ||
+            cmd == "seats") {
+            if (n != 1) {
+                return {false, "wrong number of fields\n"};
+            }
+            string payload;
+            bool found = true;
+            {
+                shared_lock<shared_mutex> guard(modelLock);
+                if (cmd == "search" || cmd == "search-i")
+                    sms.formatSearch(payload, f[1], cmd == "search-i");
+                else if (cmd == "report-course")
+                    found = sms.formatCourseReport(payload, f[1]);
+                else if (cmd == "seats")
+                    found = sms.formatCourseSeats(payload, f[1]);
+                else
+                    found = sms.formatStudentReport(payload, f[1]);
+            }
+            if (!found)
+                payload.assign(statusName(cmd == "report-student" ? Status::StudentNotFound : Status::CourseNotFound)).push_back('\n');
+            return {found, move(payload)};
+        }
+        if ((cmd == "export" || cmd == "export-delta" || cmd == "report-all") && n == 0) {
+            lock_guard<mutex> exporting(exportLock);
+            // A delta export becomes a full one when it is time to consolidate.
+            bool full = cmd == "export" || (cmd == "export-delta" && ModelData::consolidationDue());
+            size_t folded = full ? ModelData::changeFiles().size() : 0;
+            shared_ptr<const ModelData> version;
+            ChangeMarks marks;
+            StudentManagement::PendingCheckpoint checkpoint;
+            {
+                // Exports take the changed records with the version they
+                // write, so the two stay in step.
+                unique_lock<shared_mutex> guard(modelLock);
+                version = sms.pinVersion();
+                if (cmd != "report-all")
+                    marks = sms.takeChanges();
+                if (full)
+                    sms.beginCheckpoint(checkpoint, version);
+            }
+            MessageSink local(MessageMode::Buffered);
+            string buffer;
+            Status status = Status::Ok;
+            if (cmd == "report-all") {
+                status = version->writeAllReports(local);
+            } else if (full) {
+                status = version->exportCSV(local);
+                if (status == Status::Ok) {
+                    ModelData::removeChangeFiles();
+                    if (cmd == "export-delta" && folded)
+                        local.write("Consolidated ", folded, " change files into the full CSV files\n");
+                }
+            } else if (marks.empty()) {
+                local.write("No changes since the last export.\n");
+            } else {
+                status = version->writeChangeFile(marks, local, buffer);
+            }
+            // The CSVs are now newer than the snapshot; checkpoint like the
+            // menu does so the log keeps a base to replay onto. The snapshot
+            // is of the version just exported, written before the lock is
+            // taken to swap it in.
+            if (full && status == Status::Ok)
+                StudentManagement::writeCheckpoint(checkpoint);
+            {
+                unique_lock<shared_mutex> guard(modelLock);
+                version.reset();
+                checkpoint.version.reset();
+                if (status != Status::Ok)
+                    sms.restoreChanges(marks);
+                else if (full)
+                    sms.endCheckpoint(checkpoint);
+                sms.messageSink().take();
+            }
+            return {status == Status::Ok, local.take(), true};
+        }
+        // Analytics read a pinned version too, so they never hold up writers.
+        if (cmd == "analytics" && n <= 1) {
+            uint32_t topN = 10;
+            if (n == 1 && !parseCount(f[1], topN)) {
+                return {false, "bad top-n\n"};
+            }
+            shared_ptr<const ModelData> version;
+            {
+                shared_lock<shared_mutex> guard(modelLock);
+                version = sms.pinVersion();
+            }
+            string payload;
+            version->appendAnalytics(payload, version->computeAnalytics(topN));
+            {
+                unique_lock<shared_mutex> guard(modelLock);
+                version.reset();
+            }
+            return {true, move(payload)};
+        }
+        // Listing pages read the model but may merge new rows into a sort
+        // order, so they take the lock exclusively; they do not log.
+        if (cmd == "list-students" || cmd == "list-courses") {
+            string payload;
+            bool ok;
+            {
+                unique_lock<shared_mutex> guard(modelLock);
+                ok = formatListRequest(sms, f, payload);
+            }
+            return {ok, ok ? payload : string("bad order, limit or cursor\n")};
+        }
+        // Metrics live outside the model and need no lock.
+        if (cmd == "metrics" && n == 0) {
+            return {true, Metrics::prometheusText()};
+        }
+        if (cmd == "quit") {
+            quit = true;
+            return {true, ""};
+        }
+
+        // An enroll claims its seat under the shared lock, so concurrent
+        // enrolls are ordered by their compare-and-swap on the seat count
+        // rather than by who gets the writer lock first.
+        SeatClaim claim;
+        if (cmd == "enroll" && n == 2) {
+            shared_lock<shared_mutex> guard(modelLock);
+            claim = sms.claimSeat(f[2]);
+        }
+        uint32_t capacity = 0;
+        if (cmd == "set-capacity" && n == 2 && !parseCount(f[2], capacity)) {
+            return {false, "bad capacity\n"};
+        }
+
+        Status status;
+        bool known = true;
+        string message;
+        {
+            unique_lock<shared_mutex> guard(modelLock);
+            if (cmd == "add-student" && n == 3)         status = sms.addStudent(arg(2), arg(1), arg(3));
+            else if (cmd == "remove-student" && n == 1) status = sms.removeStudent(arg(1));
+            else if (cmd == "add-course" && n == 2)     status = sms.addCourse(arg(2), arg(1));
+            else if (cmd == "remove-course" && n == 1)  status = sms.removeCourse(arg(1));
+            else if (cmd == "enroll" && n == 2)         status = sms.enrollStudentInCourse(arg(1), arg(2), claim);
+            else if (cmd == "unenroll" && n == 2)       status = sms.removeStudentFromCourse(arg(1), arg(2));
+            else if (cmd == "set-capacity" && n == 2)   status = sms.setCourseCapacity(arg(1), capacity);
+            else known = false;
+            message = sms.messageSink().take();
+        }
+        if (!known) {
+            return {false, "unknown command or wrong number of fields\n"};
+        }
+        return {status == Status::Ok, move(message), true};
+    }
+
+    // Answer every complete line buffered on the connection. Writes are
+    // logged under the model lock, but their records are made durable
+    // after it is released, once for every write in this batch of lines,
+    // and only then are the replies queued: OK if the commit succeeded,
+    // ERR if the log could not be written.
+    void handleInput(Connection &c) {
+        size_t start = 0, end;
+        bool wrote = false;
+        vector<Reply> replies;
+        while (!c.closing && (end = c.in.find('\n', start)) != string::npos) {
+            string_view line(c.in.data() + start, end - start);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (!line.empty()) {
+                replies.push_back(handleRequest(line, c.closing));
+                wrote |= replies.back().logged;
+            }
+            start = end + 1;
+        }
+        c.in.erase(0, start);
+        if (c.in.size() > kMaxRequestBytes)
+            c.closing = true;
+        bool durable = true;
+        if (wrote) {
+            uint64_t ticket;
+            {
+                unique_lock<shared_mutex> guard(modelLock);
+                ticket = sms.startLogCommit();
+            }
+            durable = sms.finishLogCommit(ticket);
+        }
+        for (Reply &reply : replies) {
+            if (reply.logged && !durable) {
+                reply.ok = false;
+                reply.payload.append("operation log write failed; the change is not durable\n");
+            }
+            appendReply(c.out, reply.ok, reply.payload);
+        }
+    }
+
+    // Send what is pending; false once the connection should be dropped.
+    bool flush(Connection &c) {
+        while (c.sent < c.out.size()) {
+            ssize_t n = ::send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+            if (n < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            c.sent += static_cast<size_t>(n);
+        }
+        c.out.clear();
+        c.sent = 0;
+        return !c.closing;
+    }
+
+    void runWorker() {
+        int ep = epoll_create1(EPOLL_CLOEXEC);
+        if (ep < 0)
+            return;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = listenFd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, listenFd, &ev);
+
+        unordered_map<int, Connection> conns;
+        auto drop = [&](int fd) {
+            epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+            ::close(fd);
+            conns.erase(fd);
+        };
+        epoll_event events[64];
+        char buf[16384];
+        while (!stopFlag()) {
+            int ready = epoll_wait(ep, events, 64, 200);
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    int cfd;
+                    while ((cfd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                        int one = 1;
+                        setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                        epoll_event cev{};
+                        cev.events = EPOLLIN | EPOLLRDHUP;
+                        cev.data.fd = cfd;
+                        epoll_ctl(ep, EPOLL_CTL_ADD, cfd, &cev);
+                        conns.emplace(cfd, Connection{cfd, string(), string()});
+                    }
+                    continue;
+                }
+                auto it = conns.find(fd);
+                if (it == conns.end())
+                    continue;
+                Connection &c = it->second;
+                bool alive = true;
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    ssize_t n;
+                    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0)
+                        c.in.append(buf, static_cast<size_t>(n));
+                    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                        c.closing = true;
+                    handleInput(c);
+                }
+                alive = flush(c);
+                if (!alive || (c.closing && c.out.empty())) {
+                    drop(fd);
+                    continue;
+                }
+                epoll_event cev{};
+                cev.events = EPOLLIN | EPOLLRDHUP | (c.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+                cev.data.fd = fd;
+                epoll_ctl(ep, EPOLL_CTL_MOD, fd, &cev);
+            }
+        }
+        for (auto &entry : conns)
+            ::close(entry.first);
+        ::close(ep);
+    }
+
+public:
+    explicit StudentServer(StudentManagement &sms) : sms(sms) {}
+
+    ~StudentServer() {
+        if (listenFd >= 0)
+            ::close(listenFd);
+    }
+
+    bool listen(const string &address, uint16_t port) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+            return false;
+        listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            return false;
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        return ::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 &&
+               ::listen(listenFd, SOMAXCONN) == 0;
+    }
+
+    // Serve until SIGINT or SIGTERM, then save like the menu's exit.
+    void run(size_t threads = ThreadPool::defaultThreads()) {
+        stopFlag() = false;
+        signal(SIGINT, onSignal);
+        signal(SIGTERM, onSignal);
+        {
+            // Writers hand their status messages back to the client.
+            MessageScope buffered(sms.messageSink(), MessageMode::Buffered);
+            vector<thread> workers;
+            for (size_t i = 0; i < max<size_t>(1, threads); ++i)
+                workers.emplace_back([this] { runWorker(); });
+            for (thread &t : workers)
+                t.join();
+            sms.messageSink().take();
+        }
+        sms.commitLog();
+        sms.exportDataParallel();
+        sms.checkpoint();
     }
 };
+#endif
+
+// Exit code 0 on success, 1 if any operation failed, 2 on bad usage.
+int runCommandLine(StudentManagement &sms, int argc, char **argv) {
+    vector<string_view> args(argv + 1, argv + argc);
+    if (!args.empty() && (args[0] == "--quiet" || args[0] == "-q")) {
+        sms.messageSink().setMode(MessageMode::None);
+        args.erase(args.begin());
+    }
+    if (args.empty() || args[0] == "--help" || args[0] == "-h") {
+        printUsage();
+        return args.empty() ? 2 : 0;
+    }
+
+    int code = 0;
+    if (args[0] == "serve" && (args.size() == 2 || args.size() == 3)) {
+#if SMS_EPOLL
+        string address = args.size() == 3 ? string(args[2]) : string("127.0.0.1");
+        int port = atoi(string(args[1]).c_str());
+        StudentServer server(sms);
+        if (port <= 0 || port > 65535 || !server.listen(address, static_cast<uint16_t>(port))) {
+            cout << "Could not listen on " << address << ":" << args[1] << ".\n";
+            return 1;
+        }
+        cout << "Serving on " << address << ":" << port << " (Ctrl+C to stop)\n" << flush;
+        server.run();
+        return 0;
+#else
+        cout << "Server mode needs Linux (epoll).\n";
+        return 1;
+#endif
+    } else if (args[0] == "script" && args.size() == 2) {
+        string_view text;
+        string input;
+        MappedFile file(args[1] == "-" ? string() : string(args[1]));
+        if (args[1] == "-") {
+            input.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+            text = input;
+        } else if (file.isOpen()) {
+            text = file.view();
+        } else {
+            cout << "Could not open " << args[1] << ".\n";
+            return 1;
+        }
+        code = runScript(sms, text) ? 1 : 0;
+    } else {
+        Status status;
+        if (!runOperation(sms, args, status)) {
+            printUsage();
+            return 2;
+        }
+        code = status == Status::Ok ? 0 : 1;
+    }
+    sms.commitLog();
+    return code;
+}
 
 // ----------------------------
 // Main: Interactive Menu
 // ----------------------------
-int main() {
+// bench.cpp and tests.cpp include this file with SMS_NO_MAIN defined to
+// reuse the model.
+#ifndef SMS_NO_MAIN
+int main(int argc, char **argv) {
+    // Leading process options. --arena must take effect before the model
+    // allocates; --metrics[=file] turns on collection and writes the
+    // metrics on exit, to stdout without a file; --id-digits sets the
+    // student ID format the menu accepts; --compress writes exports and
+    // reports as LZ4; --lazy reads the snapshot in place.
+    string metricsFile;
+    bool dumpMetrics = false;
+    for (; argc > 1; ++argv, --argc) {
+        string_view option(argv[1]);
+        if (option == "--arena") {
+            useModelArena();
+        } else if (option == "--compress") {
+            compressExports() = true;
+        } else if (option == "--lazy") {
+            lazySnapshot() = true;
+        } else if (option.substr(0, 12) == "--id-digits=") {
+            if (!parseIdDigits(option.substr(12), studentIdFormat())) {
+                cout << "--id-digits takes <max> or <min>-<max>, each from 1 to 9.\n";
+                return 2;
+            }
+        } else if (option == "--metrics" || option.substr(0, 10) == "--metrics=") {
+            Metrics::enable();
+            dumpMetrics = true;
+            metricsFile = string(option.substr(min<size_t>(option.size(), 10)));
+        } else {
+            break;
+        }
+    }
+    auto writeMetrics = [&] {
+        if (!dumpMetrics)
+            return;
+        if (metricsFile.empty()) {
+            cout << Metrics::prometheusText();
+            return;
+        }
+        ofstream file(metricsFile);
+        file << Metrics::prometheusText();
+        if (!file)
+            cerr << "Could not write metrics to " << metricsFile << "\n";
+    };
     StudentManagement sms;
-    // Load previously saved data (if any) to ensure persistence
-    sms.loadData();
+    // Load previously saved data (if any) to ensure persistence.
+    // A current binary snapshot is fastest; otherwise parse the CSV files.
+    if (!sms.loadSnapshot())
+        sms.loadData(LoadMode::Parallel);
+    // Re-apply changes made after the last save, then log new ones.
+    sms.openLog();
+    if (argc > 1) {
+        int code = runCommandLine(sms, argc, argv);
+        writeMetrics();
+        return code;
+    }
     
     int choice;
     
@@ -646,31 +6949,41 @@ int main() {
         cout << "1. Add Student\n";
         cout << "2. Remove Student\n";
         cout << "3. List Students\n";
-        cout << "4. Search Student\n\n";
+        cout << "4. Search Student\n";
+        cout << "14. Search Student (ignore case)\n";
+        cout << "18. List Students (sorted, paged)\n\n";
         
         cout << "==============================\n";
         cout << "      Course Management\n";
         cout << "==============================\n";
         cout << "5. Add Course\n";
         cout << "6. Remove Course\n";
-        cout << "7. List Courses\n\n";
+        cout << "7. List Courses\n";
+        cout << "19. List Courses (sorted, paged)\n";
+        cout << "20. Set Course Capacity\n";
+        cout << "21. Show Course Seats and Waitlist\n\n";
         
         cout << "==============================\n";
         cout << "         Enrollment\n";
         cout << "==============================\n";
         cout << "8. Enroll Student in Course\n";
-        cout << "9. Remove Student from Course\n\n";
+        cout << "9. Remove Student from Course\n";
+        cout << "15. Batch Enroll from CSV\n\n";
         
         cout << "==============================\n";
         cout << "         Reporting\n";
         cout << "==============================\n";
         cout << "10. Generate Course Report\n";
-        cout << "11. Generate Student Report\n\n";
+        cout << "11. Generate Student Report\n";
+        cout << "16. Generate All Reports\n";
+        cout << "17. Show Operation Metrics\n";
+        cout << "22. Enrollment Analytics\n\n";
         
         cout << "==============================\n";
         cout << "         Data Export\n";
         cout << "==============================\n";
-        cout << "12. Export Data to CSV (Students & Courses)\n\n";
+        cout << "12. Export Data to CSV (Students & Courses)\n";
+        cout << "23. Export Changes Since Last Export\n\n";
         
         cout << "==============================\n";
         cout << "       Populate Dummy Data\n";
@@ -747,19 +7060,96 @@ int main() {
                     break;
                 }
                 case 12: {
-                    sms.exportStudentsToCSV();
-                    sms.exportCoursesToCSV();
+                    sms.exportDataParallel();
+                    sms.checkpoint();
                     break;
                 }
                 case 13: {
                     sms.populateDummyData();
                     break;
                 }
+                case 14: {
+                    string keyword = getNonEmptyInput("Enter keyword to search (name, ID, or course code): ");
+                    sms.searchStudent(keyword, true);
+                    break;
+                }
+                case 15: {
+                    string filename = getNonEmptyInput("Enter CSV file of studentID,courseCode rows: ");
+                    EnrollBatchReport report;
+                    if (!sms.enrollBatchFromCSV(filename, report)) {
+                        cout << "Could not open " << filename << ".\n";
+                        break;
+                    }
+                    printEnrollReport(report);
+                    break;
+                }
+                case 16: {
+                    sms.generateAllReports();
+                    break;
+                }
+                case 17: {
+                    if (!Metrics::enabled()) {
+                        Metrics::enable();
+                        cout << "Metrics collection was off and is now on; operations from here on are recorded.\n";
+                    }
+                    cout << Metrics::prometheusText();
+                    break;
+                }
+                case 18:
+                case 19: {
+                    const size_t kPageRows = 20;
+                    bool listCourses = choice == 19;
+                    string orderText = getNonEmptyInput(listCourses ? "Sort by (code/name): " : "Sort by (id/name/type): ");
+                    ListOrder order;
+                    if (!parseListOrder(toLower(orderText), listCourses, order)) {
+                        cout << "Unknown sort order.\n";
+                        break;
+                    }
+                    string cursor, page, next, reply;
+                    while (true) {
+                        page.clear();
+                        if (listCourses)
+                            sms.formatCoursePage(page, next, order, kPageRows, cursor);
+                        else
+                            sms.formatStudentPage(page, next, order, kPageRows, cursor);
+                        cout << page;
+                        if (next.empty())
+                            break;
+                        cout << "Press Enter for the next page, or q to stop: ";
+                        if (!getline(cin, reply) || (!reply.empty() && toLower(trim(reply)) == "q"))
+                            break;
+                        cursor = next;
+                    }
+                    break;
+                }
+                case 20: {
+                    string courseCode = getNonEmptyInput("Enter course code: ");
+                    string seatsText = getNonEmptyInput("Enter capacity (0 for unlimited): ");
+                    uint32_t capacity;
+                    if (!parseCount(seatsText, capacity)) {
+                        cout << "Capacity must be a whole number.\n";
+                        break;
+                    }
+                    sms.setCourseCapacity(courseCode, capacity);
+                    break;
+                }
+                case 21: {
+                    string courseCode = getNonEmptyInput("Enter course code: ");
+                    sms.showCourseSeats(courseCode);
+                    break;
+                }
+                case 22: {
+                    sms.generateAnalyticsReport();
+                    break;
+                }
+                case 23: {
+                    sms.exportDelta();
+                    break;
+                }
                 case 0: {
+                    // Every change is already in the operation log, which is
+                    // committed below; the CSVs are only written on request.
                     cout << "Exiting the system. Goodbye!\n";
-                    // Export data on exit to preserve changes
-                    sms.exportStudentsToCSV();
-                    sms.exportCoursesToCSV();
                     break;
                 }
                 default: {
@@ -771,8 +7161,11 @@ int main() {
         catch (const OperationCancelledException &e) {
             cout << e.what() << "\n"; // Inform the user and return to main menu.
         }
+        sms.commitLog();
         
     } while (choice != 0);
 
+    writeMetrics();
     return 0;
 }
+#endif
@@ -0,0 +1,764 @@
+// Regression tests for the Student Management System.
+//
+// Builds the model from main.cpp without its menu and checks the parts
+// whose failures would not show up in day-to-day use: persistence formats
+// and their recovery paths, and the CPU-specific kernels against their
+// portable versions. Every test runs in a fresh scratch directory,
+// since the model reads and writes its files relative to the working
+// directory; the data next to the binary is never touched.
+//
+//   g++ -std=c++17 -O2 -pthread tests.cpp -o sms-tests
+//   ./sms-tests                 run every test
+//   ./sms-tests snapshot        run the tests whose names start with "snapshot"
+//
+// Each failed check prints one line; the exit status is 1 if any failed.
+#define SMS_NO_MAIN
+#include "main.cpp"
+
+#include <random>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const string &what) {
+    if (ok)
+        return;
+    failures++;
+    cerr << "  FAILED: " << what << "\n";
+}
+
+// The model reports on cout; tests only want their own output.
+class Silence {
+private:
+    streambuf *saved;
+
+public:
+    Silence() : saved(cout.rdbuf(nullptr)) {}
+    ~Silence() { cout.rdbuf(saved); }
+    Silence(const Silence &) = delete;
+    Silence &operator=(const Silence &) = delete;
+};
+
+// Switches into an empty directory for the lifetime of the object.
+class ScratchDir {
+private:
+    fs::path previous;
+    fs::path path;
+
+public:
+    explicit ScratchDir(const string &name)
+        : previous(fs::current_path()), path(fs::temp_directory_path() / "sms-tests" / name) {
+        fs::remove_all(path);
+        fs::create_directories(path);
+        fs::current_path(path);
+    }
+    ~ScratchDir() {
+        error_code ec;
+        fs::current_path(previous, ec);
+        fs::remove_all(path, ec);
+    }
+    ScratchDir(const ScratchDir &) = delete;
+    ScratchDir &operator=(const ScratchDir &) = delete;
+};
+
+string readFile(const string &filename) {
+    ifstream file(filename, ios::binary);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+void writeFile(const string &filename, string_view data) {
+    ofstream file(filename, ios::binary | ios::trunc);
+    file.write(data.data(), data.size());
+}
+
+// Everything the model holds, in the CSV export formats: rows in table
+// order and both enrollment orders. Two models are equal when this is.
+string dumpModel(StudentManagement &sms) {
+    Silence quiet;
+    sms.exportStudentsToCSV();
+    sms.exportCoursesToCSV();
+    return readFile("Students/students.csv") + readFile("Courses/courses.csv");
+}
+
+// A model with removals in it, so the tables have been shifted and
+// reindexed and some interned handles no longer have a row.
+void populate(StudentManagement &sms) {
+    Silence quiet;
+    for (int i = 0; i < 40; ++i)
+        sms.addStudent("Student " + to_string(i), "S" + to_string(1000 + i),
+                       i % 3 ? "Undergraduate" : "Postgraduate");
+    for (int c = 0; c < 8; ++c)
+        sms.addCourse("Course " + to_string(c), "C" + to_string(100 + c));
+    for (int i = 0; i < 40; ++i)
+        for (int c = i % 5; c < 8; c += 3)
+            sms.enrollStudentInCourse("S" + to_string(1000 + i), "C" + to_string(100 + c));
+    sms.removeStudent("S1003");
+    sms.removeCourse("C102");
+    sms.removeStudentFromCourse("S1010", "C100");
+    sms.addStudent("Zoë Ünicode", "S2000", "Postgraduate");
+    sms.enrollStudentInCourse("S2000", "C107");
+    sms.enrollStudentInCourse("S2000", "C100");
+}
+
+// ----------------------------
+// Binary snapshot
+// ----------------------------
+void testSnapshotRoundTrip() {
+    ScratchDir dir("snapshot-round-trip");
+    StudentManagement original;
+    populate(original);
+    // The CSVs go first: the snapshot is only loaded while it is newer.
+    string expected = dumpModel(original);
+    {
+        Silence quiet;
+        check(original.saveSnapshot(), "snapshot saved");
+    }
+
+    StudentManagement loaded;
+    bool ok;
+    {
+        Silence quiet;
+        ok = loaded.loadSnapshot();
+    }
+    check(ok, "snapshot loaded");
+    check(dumpModel(loaded) == expected, "loaded model equals the saved one");
+}
+
+void testSnapshotRejectsDamage() {
+    ScratchDir dir("snapshot-damage");
+    StudentManagement original;
+    populate(original);
+    {
+        Silence quiet;
+        original.saveSnapshot();
+    }
+    string image = readFile(StudentManagement::kSnapshotFile);
+    check(image.size() > kSnapshotHeaderSize, "snapshot has a payload");
+
+    StudentManagement none;
+    string empty = dumpModel(none);
+
+    // A flipped payload byte fails the checksum and a cut file the size
+    // check; either way the model is left empty for the CSV loaders.
+    // Each damaged image is written after the last dump, so it is still
+    // newer than the CSVs.
+    auto rejects = [&](const string &damaged, const string &what) {
+        writeFile(StudentManagement::kSnapshotFile, damaged);
+        StudentManagement loaded;
+        bool ok;
+        {
+            Silence quiet;
+            ok = loaded.loadSnapshot();
+        }
+        check(!ok, what + " is rejected");
+        check(dumpModel(loaded) == empty, what + " leaves the model empty");
+    };
+    for (size_t at : {kSnapshotHeaderSize, image.size() / 2, image.size() - 1}) {
+        string damaged = image;
+        damaged[at] ^= 0x20;
+        rejects(damaged, "snapshot with byte " + to_string(at) + " flipped");
+    }
+    rejects(image.substr(0, image.size() - 1), "snapshot cut short by a byte");
+}
+
+// A lazy load reads the same model as an eager one. Damage in a chunk it
+// copies rejects the file; damage in a chunk it reads in place only
+// shows when read, as missing names, and the model then refuses to be
+// written out as a snapshot or CSV files.
+void testSnapshotLazy() {
+    ScratchDir dir("snapshot-lazy");
+    string image, expected;
+    {
+        StudentManagement original;
+        Silence quiet;
+        // Long names, so the name section spans several whole chunks.
+        for (int i = 0; i < 3000; ++i)
+            original.addStudent("Student " + to_string(i) + string(90, 'x'), "S" + to_string(1000 + i),
+                                "Undergraduate");
+        for (int c = 0; c < 4; ++c)
+            original.addCourse("Course " + to_string(c), "C" + to_string(100 + c));
+        for (int i = 0; i < 3000; ++i)
+            original.enrollStudentInCourse("S" + to_string(1000 + i), "C" + to_string(100 + i % 4));
+        expected = dumpModel(original);
+        check(original.saveSnapshot(), "snapshot saved");
+        image = readFile(StudentManagement::kSnapshotFile);
+    }
+    lazySnapshot() = true;
+    // Load `bytes` lazily and report what a few reads and writes of the
+    // model give. The CSVs are removed first, so a withheld export dumps
+    // as empty and the snapshot is always newer than them.
+    struct Loaded {
+        string dump, report;
+        bool saved;
+    };
+    auto load = [&](const string &bytes, const string &what, bool expectLoaded) {
+        fs::remove_all("Students");
+        fs::remove_all("Courses");
+        writeFile(StudentManagement::kSnapshotFile, bytes);
+        StudentManagement loaded;
+        Loaded result;
+        Silence quiet;
+        check(loaded.loadSnapshot() == expectLoaded, what + (expectLoaded ? " is loaded" : " is rejected"));
+        loaded.formatStudentReport(result.report, "S1000");
+        loaded.formatStudentReport(result.report, "S2500");
+        result.dump = dumpModel(loaded);
+        result.saved = loaded.saveSnapshot();
+        return result;
+    };
+
+    Loaded intact = load(image, "lazy snapshot", true);
+    check(intact.dump == expected, "lazily loaded model equals the saved one");
+    check(intact.saved, "lazily loaded model saved");
+
+    size_t at = image.find("Student 1500x");
+    check(at != string::npos, "name found in the snapshot");
+    string damaged = image;
+    damaged[at + 20] ^= 0x20;
+    streambuf *savedErr = cerr.rdbuf(nullptr);
+    Loaded lazyDamage = load(damaged, "snapshot with a damaged name chunk", true);
+    cerr.rdbuf(savedErr);
+    check(lazyDamage.report.find("S2500,,Undergraduate") != string::npos, "names in the damaged chunk read as missing");
+    check(lazyDamage.report.find("S1000,Student 0x") != string::npos, "other chunks still read");
+    check(lazyDamage.dump.empty(), "model from a damaged snapshot is not exported");
+    check(!lazyDamage.saved, "model from a damaged snapshot is not saved");
+
+    damaged = image;
+    damaged[image.find("S2999") + 1] ^= 0x20; // in the student ID strings, which come first
+    load(damaged, "snapshot with a damaged copied chunk", false);
+    lazySnapshot() = false;
+}
+
+// ----------------------------
+// Operation log
+// ----------------------------
+// Offsets just past each record in a log image, read from the record
+// headers; the image must be intact.
+vector<size_t> logRecordEnds(string_view image) {
+    vector<size_t> ends;
+    size_t pos = kLogHeaderSize;
+    while (pos + 8 <= image.size()) {
+        uint32_t len;
+        memcpy(&len, image.data() + pos, 4);
+        pos += 8 + len;
+        ends.push_back(pos);
+    }
+    return ends;
+}
+
+// The mutations of a short session, one log record each.
+const vector<function<void(StudentManagement &)>> kSessionOps = {
+    [](StudentManagement &s) { s.addStudent("Ann Lee", "S1", "Undergraduate"); },
+    [](StudentManagement &s) { s.addStudent("Bo Chan", "S2", "Postgraduate"); },
+    [](StudentManagement &s) { s.addCourse("Algorithms", "C1"); },
+    [](StudentManagement &s) { s.addCourse("Databases", "C2"); },
+    [](StudentManagement &s) { s.enrollStudentInCourse("S1", "C1"); },
+    [](StudentManagement &s) { s.enrollStudentInCourse("S2", "C1"); },
+    [](StudentManagement &s) { s.enrollStudentInCourse("S1", "C2"); },
+    [](StudentManagement &s) { s.removeStudentFromCourse("S1", "C1"); },
+    [](StudentManagement &s) { s.removeStudent("S2"); },
+    [](StudentManagement &s) { s.addStudent("Cy Diaz", "S3", "Undergraduate"); },
+    [](StudentManagement &s) { s.enrollStudentInCourse("S3", "C2"); },
+    [](StudentManagement &s) { s.removeCourse("C1"); },
+};
+
+// Run kSessionOps on a fresh model with its log open and return the log.
+// states[k] is the model after the first k operations.
+string recordSession(vector<string> &states) {
+    StudentManagement writer;
+    Silence quiet;
+    writer.openLog();
+    states.assign(1, dumpModel(writer));
+    for (const auto &op : kSessionOps) {
+        op(writer);
+        states.push_back(dumpModel(writer));
+    }
+    check(writer.commitLog(), "session log committed");
+    return readFile(StudentManagement::kLogFile);
+}
+
+// Cut the log of a session at every byte offset. Replay must keep exactly
+// the records that fit, cut the file back to them and append after them.
+void testLogTruncation() {
+    ScratchDir dir("log-truncation");
+    vector<string> states;
+    string image = recordSession(states);
+    vector<size_t> ends = logRecordEnds(image);
+    check(ends.size() == kSessionOps.size(), "one record per operation");
+    if (ends.size() != kSessionOps.size() || ends.back() != image.size())
+        return;
+
+    for (size_t cut = 0; cut <= image.size(); ++cut) {
+        size_t kept = upper_bound(ends.begin(), ends.end(), cut) - ends.begin();
+        size_t validBytes = kept ? ends[kept - 1] : kLogHeaderSize;
+        string at = "log cut at byte " + to_string(cut);
+        writeFile(StudentManagement::kLogFile, image.substr(0, cut));
+        {
+            StudentManagement reader;
+            Silence quiet;
+            reader.openLog();
+            check(dumpModel(reader) == states[kept], at + " replays the " + to_string(kept) + " whole records");
+            check(fs::file_size(StudentManagement::kLogFile) == validBytes, at + " is cut back to them");
+            reader.addStudent("Late Arrival", "S9", "Undergraduate");
+            check(reader.commitLog(), at + " takes new records");
+        }
+        // The record appended after the cut replays on top of the rest.
+        StudentManagement again;
+        Silence quiet;
+        again.openLog();
+        string expected;
+        {
+            StudentManagement replica;
+            for (size_t i = 0; i < kept; ++i)
+                kSessionOps[i](replica);
+            replica.addStudent("Late Arrival", "S9", "Undergraduate");
+            expected = dumpModel(replica);
+        }
+        check(dumpModel(again) == expected, at + " replays the appended record after the kept ones");
+    }
+}
+
+// A record whose bytes no longer match its checksum ends the replay there,
+// as a torn tail does.
+void testLogDamagedRecord() {
+    ScratchDir dir("log-damage");
+    vector<string> states;
+    string image = recordSession(states);
+    vector<size_t> ends = logRecordEnds(image);
+    for (size_t i = 0; i < ends.size(); ++i) {
+        string damaged = image;
+        damaged[ends[i] - 1] ^= 0x01;
+        writeFile(StudentManagement::kLogFile, damaged);
+        StudentManagement reader;
+        Silence quiet;
+        reader.openLog();
+        check(dumpModel(reader) == states[i], "log with record " + to_string(i) + " damaged replays the ones before it");
+    }
+}
+
+// A batch enrollment is logged as a few EnrollBatch records rather than
+// one record per edge, and replays to the same enrollment order.
+void testLogEnrollBatch() {
+    ScratchDir dir("log-enroll-batch");
+    const size_t kStudents = 300, kCourses = 230;
+    string expected, image;
+    {
+        StudentManagement writer;
+        Silence quiet;
+        writer.openLog();
+        for (size_t i = 0; i < kStudents; ++i)
+            writer.addStudent("Student " + to_string(i), "S" + to_string(i), "Undergraduate");
+        for (size_t c = 0; c < kCourses; ++c)
+            writer.addCourse("Course " + to_string(c), "C" + to_string(c));
+        vector<string> ids, codes;
+        for (size_t i = 0; i < kStudents; ++i)
+            ids.push_back("S" + to_string(i));
+        for (size_t c = 0; c < kCourses; ++c)
+            codes.push_back("C" + to_string(c));
+        vector<pair<string_view, string_view>> pairs;
+        for (size_t c = kCourses; c-- > 0;)
+            for (size_t i = 0; i < kStudents; ++i)
+                pairs.emplace_back(ids[(i * 7 + c) % kStudents], codes[c]);
+        pairs.emplace_back("S0", "C0"); // a duplicate row, not linked twice
+        EnrollBatchReport report = writer.enrollBatch(pairs);
+        check(report.enrolled == kStudents * kCourses, "every distinct pair enrolled");
+        check(writer.commitLog(), "batch committed");
+        expected = dumpModel(writer);
+        image = readFile(StudentManagement::kLogFile);
+    }
+    size_t edges = kStudents * kCourses;
+    size_t batchRecords = (edges + StudentManagement::kBatchRecordEdges - 1) / StudentManagement::kBatchRecordEdges;
+    check(logRecordEnds(image).size() == kStudents + kCourses + batchRecords,
+          "the batch is logged as " + to_string(batchRecords) + " records");
+
+    StudentManagement reader;
+    Silence quiet;
+    reader.openLog();
+    check(dumpModel(reader) == expected, "replayed batch equals the original");
+}
+
+// Capacities, waitlists and the promotions they lead to. Promotions are
+// logged as enrolls, so replay must rebuild the same seats and waitlists
+// without promoting anyone itself; a snapshot must hold them too.
+void testLogSeats() {
+    ScratchDir dir("log-seats");
+    auto seatsOf = [](StudentManagement &sms) {
+        string out;
+        for (const char *code : {"C1", "C2", "C3"})
+            sms.formatCourseSeats(out, code);
+        return dumpModel(sms) + out;
+    };
+    string expected;
+    {
+        StudentManagement writer;
+        Silence quiet;
+        writer.openLog();
+        for (int i = 1; i <= 8; ++i)
+            writer.addStudent("Student " + to_string(i), "S" + to_string(i), "Undergraduate");
+        for (const char *code : {"C1", "C2", "C3"})
+            writer.addCourse(string("Course ") + code, code);
+        writer.setCourseCapacity("C1", 2);
+        writer.setCourseCapacity("C2", 1);
+        for (int i = 1; i <= 6; ++i)
+            writer.enrollStudentInCourse("S" + to_string(i), "C1");
+        writer.enrollBatch({{"S7", "C2"}, {"S8", "C2"}, {"S1", "C2"}, {"S2", "C3"}});
+        writer.removeStudentFromCourse("S1", "C1"); // S3 is promoted
+        writer.removeStudentFromCourse("S5", "C1"); // leaves the waitlist
+        writer.removeStudent("S7");                 // S8 is promoted into C2
+        writer.setCourseCapacity("C1", 3);          // S4 is promoted
+        writer.removeStudent("S6");                 // drops off the C1 waitlist
+        writer.removeCourse("C3");
+        check(writer.commitLog(), "session committed");
+        expected = seatsOf(writer);
+    }
+    {
+        StudentManagement reader;
+        Silence quiet;
+        reader.openLog();
+        check(seatsOf(reader) == expected, "replayed seats and waitlists equal the original");
+        check(reader.saveSnapshot(), "snapshot saved");
+    }
+    StudentManagement loaded;
+    Silence quiet;
+    check(loaded.loadSnapshot(), "snapshot loaded");
+    check(seatsOf(loaded) == expected, "loaded seats and waitlists equal the original");
+}
+
+// Records changed since the last export are only marked in memory. The
+// marks must come back from the log and from a snapshot, or the next
+// delta export would leave those records out.
+void testLogChanges() {
+    ScratchDir dir("log-changes");
+    auto takeChangeFile = [] {
+        vector<fs::path> files = ModelData::changeFiles();
+        string body = files.size() == 1 ? readFile(files[0].string()) : string();
+        ModelData::removeChangeFiles();
+        return body;
+    };
+    {
+        StudentManagement writer;
+        Silence quiet;
+        writer.openLog();
+        populate(writer);
+        check(writer.exportDataParallel() == Status::Ok, "full export written");
+        writer.addStudent("Student New", "S3000", "Undergraduate");
+        writer.enrollStudentInCourse("S3000", "C101");
+        writer.addStudent("Student Waiting", "S3001", "Postgraduate");
+        writer.removeStudent("S1020"); // was in C100, C103 and C106
+        check(writer.commitLog(), "session committed");
+    }
+    string fromLog;
+    {
+        StudentManagement reader;
+        Silence quiet;
+        reader.openLog();
+        check(reader.saveSnapshot(), "snapshot saved");
+        check(reader.exportDelta() == Status::Ok, "delta export after replay");
+        fromLog = takeChangeFile();
+    }
+    check(count(fromLog.begin(), fromLog.end(), '\n') == 8, "three students and four courses changed");
+    check(fromLog.find("student,upsert,S3000,Student New,Undergraduate,C101\n") != string::npos,
+          "added student is an upsert");
+    check(fromLog.find("student,upsert,S3001,Student Waiting,Postgraduate,\n") != string::npos,
+          "student without courses is an upsert");
+    check(fromLog.find("student,delete,S1020,,,\n") != string::npos, "removed student is a delete");
+
+    StudentManagement loaded;
+    Silence quiet;
+    check(loaded.loadSnapshot(), "snapshot loaded");
+    check(loaded.exportDelta() == Status::Ok, "delta export after loading");
+    check(takeChangeFile() == fromLog, "the snapshot keeps the same changes");
+}
+
+// A checkpoint taken in steps, as the server does for an export, keeps
+// what was logged while its snapshot was written, also when the process
+// stops between the snapshot and log renames.
+void testLogRebase() {
+    ScratchDir dir("log-rebase");
+    const string logFile = StudentManagement::kLogFile, tempLog = logFile + ".tmp";
+    const size_t kBefore = 6;
+    string expected, oldLog, newLog;
+    {
+        StudentManagement writer;
+        Silence quiet;
+        writer.openLog();
+        for (size_t i = 0; i < kBefore; ++i)
+            kSessionOps[i](writer);
+        StudentManagement::PendingCheckpoint pending;
+        writer.beginCheckpoint(pending, writer.pinVersion());
+        for (size_t i = kBefore; i < kSessionOps.size(); ++i)
+            kSessionOps[i](writer);
+        check(writer.commitLog(), "records after the mark committed");
+        StudentManagement::writeCheckpoint(pending);
+        oldLog = readFile(logFile);
+        writer.endCheckpoint(pending);
+        newLog = readFile(logFile);
+        expected = dumpModel(writer);
+    }
+    check(logRecordEnds(newLog).size() == kSessionOps.size() - kBefore,
+          "the rebased log holds only the records after the mark");
+    check(!fs::exists(tempLog), "no rebased log is left beside the log");
+
+    auto reloads = [&](const string &what) {
+        // The dumps wrote the CSVs after the snapshot.
+        fs::last_write_time(StudentManagement::kSnapshotFile, fs::file_time_type::clock::now());
+        StudentManagement reader;
+        Silence quiet;
+        check(reader.loadSnapshot(), what + ": snapshot loaded");
+        reader.openLog();
+        check(dumpModel(reader) == expected, what + ": replays to the writer's state");
+        check(!fs::exists(tempLog), what + ": no rebased log is left");
+    };
+    reloads("rebased log");
+    // Stopped before the log rename: the old log is still in place.
+    writeFile(logFile, oldLog);
+    writeFile(tempLog, newLog);
+    reloads("interrupted rebase");
+    // A rebased log for a snapshot that never got renamed in is stale.
+    string stale = newLog;
+    stale[kLogHeaderSize - 1] ^= 0x01;
+    writeFile(tempLog, stale);
+    reloads("stale rebased log");
+}
+
+// ----------------------------
+// LZ4 frames
+// ----------------------------
+// The blocks of an LZ4 file, decoded and joined; `ok` is false if the
+// reader found damage.
+string decodeLz4(string_view data, bool &ok) {
+    Lz4FrameReader reader(data);
+    string text, block;
+    while (reader.next(block))
+        text.append(block);
+    ok = !reader.failed();
+    return text;
+}
+
+string fromHex(string_view hex) {
+    string bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2)
+        bytes.push_back(static_cast<char>(stoi(string(hex.substr(i, 2)), nullptr, 16)));
+    return bytes;
+}
+
+// Inputs around the compressor's edges (too short to search, one byte
+// past a block) and both compressible and random data, each as a frame
+// of its own and all of them as frames back to back.
+void testLz4RoundTrip() {
+    mt19937 rng(11);
+    vector<string> inputs;
+    for (size_t size : {size_t(0), size_t(1), size_t(12), size_t(13), size_t(4096), kLz4BlockSize + 1}) {
+        string text;
+        for (size_t i = 0; i < size; ++i)
+            text.push_back(static_cast<char>('a' + (i / 7 + i % 3) % 26));
+        inputs.push_back(text);
+        for (char &c : text)
+            c = static_cast<char>(rng());
+        inputs.push_back(text);
+    }
+    string all, joined;
+    for (const string &input : inputs) {
+        string frame;
+        lz4AppendFrame(frame, input);
+        bool ok;
+        check(decodeLz4(frame, ok) == input && ok, "a frame of " + to_string(input.size()) + " bytes round trips");
+        all.append(frame);
+        joined.append(input);
+    }
+    bool ok;
+    check(decodeLz4(all, ok) == joined && ok, "concatenated frames decode to the joined inputs");
+}
+
+// A file from the lz4 1.9.4 tool, with the options the writer here never
+// uses: 64 KiB linked blocks (the second refers back into the first),
+// block checksums and a content size. Made with
+//   lz4 -B4 -BD -BX --content-size rows.csv rows.csv.lz4
+// from the 1800 lines below.
+const char *const kToolFrameHex =
+    "04224d185c4040190100000000001151010000f01953313030302c53747564656e742030"
+    "2c556e64657267726164756174652c433130303b433130310a2800153128001f3128000a"
+    "153228001f3228000a153328001f3328000a0fa000ffffffffffffffffffffffffffffff"
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+    "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"
+    "ffffffffffffffffffffffffffffffffffffffffffffffffff44506e7420322ca2bf7912"
+    "270000000ff0ff090fa0ffffffffffffffffffffffffffffffffffffffffffffffffffff"
+    "2550433130310a1beda689000000001f548af2";
+
+void testLz4ToolFrame() {
+    string rows;
+    for (int i = 0; i < 1800; ++i)
+        rows += "S" + to_string(1000 + i % 4) + ",Student " + to_string(i % 4) + ",Undergraduate,C100;C101\n";
+    const string frame = fromHex(kToolFrameHex);
+    bool ok;
+    check(decodeLz4(frame, ok) == rows && ok, "the lz4 tool's frame decodes");
+
+    // After a skippable frame, one of ours follows in the same file.
+    string extra = "S2000,Student 5,Postgraduate,\n", file = frame;
+    appendLE32(file, 0x184D2A53);
+    appendLE32(file, 3);
+    file.append("abc");
+    lz4AppendFrame(file, extra);
+    check(decodeLz4(file, ok) == rows + extra && ok, "a skippable frame is skipped");
+
+    string damaged = frame;
+    damaged[30] ^= 0x01; // in the first block
+    decodeLz4(damaged, ok);
+    check(!ok, "a damaged block fails its checksum");
+    damaged = frame;
+    damaged[damaged.size() - 1] ^= 0x01;
+    decodeLz4(damaged, ok);
+    check(!ok, "a damaged content checksum is caught");
+    decodeLz4(string_view(frame).substr(0, frame.size() - 10), ok);
+    check(!ok, "a cut frame is caught");
+}
+
+// --compress exports and reports, read back by both loaders.
+void testLz4Export() {
+    ScratchDir dir("lz4-export");
+    StudentManagement original;
+    populate(original);
+    string expected = dumpModel(original);
+    string report;
+    {
+        Silence quiet;
+        original.generateReportForCourse("C100");
+        report = readFile("Reports/CourseReports/C100.csv");
+    }
+
+    for (LoadMode mode : {LoadMode::Fast, LoadMode::Parallel}) {
+        compressExports() = true;
+        {
+            Silence quiet;
+            check(original.exportDataParallel() == Status::Ok, "compressed export written");
+            original.generateReportForCourse("C100");
+        }
+        compressExports() = false;
+        check(fs::exists("Students/students.csv.lz4") && !fs::exists("Students/students.csv"),
+              "the compressed export replaces the plain file");
+        bool ok;
+        check(decodeLz4(readFile("Reports/CourseReports/C100.csv.lz4"), ok) == report && ok,
+              "compressed report equals the plain one");
+
+        StudentManagement loaded;
+        {
+            Silence quiet;
+            loaded.loadData(mode);
+        }
+        check(dumpModel(loaded) == expected,
+              string(mode == LoadMode::Fast ? "fast" : "parallel") + " load of the compressed export");
+    }
+}
+
+// ----------------------------
+// Scan kernels
+// ----------------------------
+// The plain definition every kernel has to agree with.
+size_t referenceFind(string_view text, string_view needle, bool ignoreCase, size_t from) {
+    auto fold = [&](char c) { return ignoreCase && c >= 'A' && c <= 'Z' ? char(c | 0x20) : c; };
+    for (size_t i = from; i + needle.size() <= text.size(); ++i) {
+        size_t j = 0;
+        while (j < needle.size() && fold(text[i + j]) == fold(needle[j]))
+            ++j;
+        if (j == needle.size())
+            return i;
+    }
+    return string_view::npos;
+}
+
+// Every kernel this CPU can run, against referenceFind on random texts
+// of up to a few vector widths, from every start offset. The alphabet
+// mixes letters with the bytes one 0x20 fold away from them ('@', '[',
+// '`', '{') and UTF-8 bytes, which must never match a letter.
+void testScanKernels() {
+    vector<pair<const char *, ScanFindFn>> kernels = {{"scalar", scanFindScalar}};
+#if SMS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+        kernels.emplace_back("sse4.2", scanFindSse42);
+    if (__builtin_cpu_supports("avx2"))
+        kernels.emplace_back("avx2", scanFindAvx2);
+#endif
+    const string alphabet = "aAbBzZ@[`{ \xc3\xa9";
+    mt19937 rng(7);
+    auto randomText = [&](size_t length) {
+        string text;
+        for (size_t i = 0; i < length; ++i)
+            text.push_back(alphabet[rng() % alphabet.size()]);
+        return text;
+    };
+    size_t mismatches = 0;
+    for (int round = 0; round < 400; ++round) {
+        string text = randomText(rng() % 140);
+        for (int n = 0; n < 6; ++n) {
+            // Half the needles are cut from the text with some letters
+            // flipped in case, so there is something to find.
+            string needle = randomText(rng() % 6);
+            if (n % 2 && !text.empty()) {
+                size_t at = rng() % text.size();
+                needle = text.substr(at, 1 + rng() % 40);
+                for (char &c : needle)
+                    if (isalpha(static_cast<unsigned char>(c)) && rng() % 2)
+                        c ^= 0x20;
+            }
+            for (bool ignoreCase : {false, true}) {
+                for (size_t from = 0; from <= text.size(); ++from) {
+                    size_t expected = referenceFind(text, needle, ignoreCase, from);
+                    for (const auto &kernel : kernels) {
+                        if (kernel.second(text, needle, ignoreCase, from) == expected)
+                            continue;
+                        if (mismatches++ < 5)
+                            check(false, string(kernel.first) + " finds \"" + needle + "\" in \"" + text + "\" from " +
+                                             to_string(from) + (ignoreCase ? " ignoring case" : ""));
+                    }
+                }
+            }
+        }
+    }
+    check(mismatches == 0, to_string(mismatches) + " kernel results differ from the reference");
+    check(scanFind("abc", "c", false, 4) == string_view::npos, "scanFind from past the end finds nothing");
+}
+
+struct Test {
+    const char *name;
+    void (*run)();
+};
+
+const Test kTests[] = {
+    {"snapshot-round-trip", testSnapshotRoundTrip},
+    {"snapshot-damage", testSnapshotRejectsDamage},
+    {"snapshot-lazy", testSnapshotLazy},
+    {"log-truncation", testLogTruncation},
+    {"log-damage", testLogDamagedRecord},
+    {"log-enroll-batch", testLogEnrollBatch},
+    {"log-seats", testLogSeats},
+    {"log-changes", testLogChanges},
+    {"log-rebase", testLogRebase},
+    {"lz4-round-trip", testLz4RoundTrip},
+    {"lz4-tool-frame", testLz4ToolFrame},
+    {"lz4-export", testLz4Export},
+    {"scan-kernels", testScanKernels},
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    size_t ran = 0;
+    for (const Test &test : kTests) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i)
+            selected = string_view(test.name).substr(0, strlen(argv[i])) == argv[i];
+        if (!selected)
+            continue;
+        int before = failures;
+        test.run();
+        cout << (failures == before ? "ok   " : "FAIL ") << test.name << "\n";
+        ran++;
+    }
+    cout << ran << " tests, " << failures << " failed checks\n";
+    return failures ? 1 : 0;
+}